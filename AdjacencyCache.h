@@ -0,0 +1,48 @@
+#ifndef ADJACENCY_CACHE_H
+#define ADJACENCY_CACHE_H
+
+#include "Graph.h"
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <functional>
+
+using namespace std;
+
+const size_t DEFAULT_ADJACENCY_CACHE_SIZE = 65536;
+
+// Bounded LRU cache of per-node adjacency lists. A miss calls the loader,
+// which fetches the node's roads from storage, so a search only brings in
+// the nodes it actually reaches. Not thread-safe.
+class AdjacencyCache {
+public:
+    typedef function<void(int nodeId, vector<Neighbor>& out)> Loader;
+
+private:
+    struct Entry {
+        vector<Neighbor> neighbors;
+        list<int>::iterator position;
+    };
+
+    Loader loader;
+    size_t capacity;
+    list<int> recency;
+    unordered_map<int, Entry> entries;
+    long long hits;
+    long long misses;
+
+public:
+    AdjacencyCache(Loader loader, size_t capacity = DEFAULT_ADJACENCY_CACHE_SIZE);
+
+    // The reference stays valid until the next call on the cache.
+    const vector<Neighbor>& getNeighbors(int nodeId);
+    void invalidate(int nodeId);
+    void clear();
+
+    size_t getSize() const { return entries.size(); }
+    size_t getCapacity() const { return capacity; }
+    long long getHits() const { return hits; }
+    long long getMisses() const { return misses; }
+};
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <memory_resource>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+// Bump-pointer arena. Allocation advances a pointer inside the current
+// chunk, deallocate() is a no-op, and release() hands every chunk back at
+// once. It is a pmr::memory_resource, so standard containers can build in it
+// through pmr::polymorphic_allocator. Not thread-safe.
+class Arena : public pmr::memory_resource {
+private:
+    static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+    static const size_t MAX_CHUNK_SIZE = 16 * 1024 * 1024;
+
+    vector<void*> chunks;
+    char* cursor;
+    char* limit;
+    size_t nextChunkSize;
+    size_t bytesUsed;
+    size_t bytesReserved;
+
+    void* newChunk(size_t bytes) {
+        void* chunk = ::operator new(bytes);
+        chunks.push_back(chunk);
+        bytesReserved += bytes;
+        return chunk;
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        uintptr_t aligned = (reinterpret_cast<uintptr_t>(cursor) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        if (cursor == nullptr || aligned + bytes > reinterpret_cast<uintptr_t>(limit)) {
+            // Oversized requests get a chunk of their own and leave the
+            // current chunk in place for the small ones that follow.
+            if (bytes + alignment > nextChunkSize / 4) {
+                uintptr_t own = reinterpret_cast<uintptr_t>(newChunk(bytes + alignment));
+                bytesUsed += bytes;
+                return reinterpret_cast<void*>((own + alignment - 1) & ~(uintptr_t)(alignment - 1));
+            }
+
+            char* chunk = static_cast<char*>(newChunk(nextChunkSize));
+            cursor = chunk;
+            limit = chunk + nextChunkSize;
+            if (nextChunkSize < MAX_CHUNK_SIZE) {
+                nextChunkSize *= 2;
+            }
+            aligned = (reinterpret_cast<uintptr_t>(cursor) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        }
+
+        cursor = reinterpret_cast<char*>(aligned + bytes);
+        bytesUsed += bytes;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+public:
+    Arena() : cursor(nullptr), limit(nullptr), nextChunkSize(DEFAULT_CHUNK_SIZE),
+              bytesUsed(0), bytesReserved(0) {}
+
+    ~Arena() {
+        release();
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Frees every chunk. Objects placed in the arena must already be
+    // destroyed, or be trivially destructible.
+    void release() {
+        for (void* chunk : chunks) {
+            ::operator delete(chunk);
+        }
+        chunks.clear();
+        cursor = nullptr;
+        limit = nullptr;
+        nextChunkSize = DEFAULT_CHUNK_SIZE;
+        bytesUsed = 0;
+        bytesReserved = 0;
+    }
+
+    size_t getChunkCount() const { return chunks.size(); }
+    size_t getBytesUsed() const { return bytesUsed; }
+    size_t getBytesReserved() const { return bytesReserved; }
+};
+
+#endif
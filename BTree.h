@@ -2,35 +2,814 @@
 #define BTREE_H
 
 #include "BTreeNode.h"
+#include "KeyFilter.h"
 #include <string>
 #include <vector>
 #include <utility>
+#include <fstream>
+#include <sstream>
+#include <charconv>
+#include <queue>
+#include <type_traits>
+#include <thread>
+#include <algorithm>
 
 using namespace std;
 
+// Converts stored values to and from the text written in the .dat files.
+// Record types (Location, Edge) provide serialize() and a static
+// deserialize(key, data); the codec is only used by save/load, never by lookups.
+template<typename V, typename Enable = void>
+struct BTreeCodec {
+    static string encode(const V& value) { return value.serialize(); }
+
+    template<typename K>
+    static V decode(const K& key, const string& data) { return V::deserialize(key, data); }
+};
+
+template<>
+struct BTreeCodec<string> {
+    static string encode(const string& value) { return value; }
+
+    template<typename K>
+    static string decode(const K&, const string& data) { return data; }
+};
+
+// Fixed-layout records: arithmetic values are stored inline in the node.
+template<typename V>
+struct BTreeCodec<V, typename enable_if<is_arithmetic<V>::value>::type> {
+    static string encode(const V& value) {
+        ostringstream oss;
+        oss.precision(17);
+        oss << value;
+        return oss.str();
+    }
+
+    template<typename K>
+    static V decode(const K&, const string& data) {
+        istringstream iss(data);
+        V value{};
+        iss >> value;
+        return value;
+    }
+};
+
+template<typename K, typename V, int ORDER = BTREE_ORDER>
 class BTree {
 private:
-    BTreeNode* root;
+    typedef BTreeNode<K, V, ORDER> Node;
+
+    Node* root;
     int nodeCounter;
+    int entryCount;
+    K maxKey;
+    Arena arena;
+    KeyFilter<K> filter;
+
+    void rebuildFilter();
+    // Replaces the tree with one built bottom-up from records sorted by
+    // strictly increasing key, every node filled as evenly as possible.
+    void buildFromSorted(vector<pair<K, V>>& records);
+
+    // One NODE_ line of a .dat file, parsed but not yet placed in the arena.
+    struct ParsedNode {
+        int nodeId;
+        bool isLeaf;
+        vector<K> keys;
+        vector<V> values;
+        vector<int> children;
+    };
+
+    static const size_t LOAD_BATCH_LINES = 4096;
+    static const size_t PARALLEL_PARSE_MIN_LINES = 256;
+
+    static bool parseNodeLine(const string& line, ParsedNode& parsed);
+    static void parseBatch(const vector<string>& lines, vector<ParsedNode>& parsed);
 
-    void assignNodeIds(BTreeNode* node, vector<BTreeNode*>& nodes);
-    void collectNodes(BTreeNode* node, vector<BTreeNode*>& nodes);
+    void assignNodeIds(Node* node, vector<Node*>& nodes);
+    void collectNodes(Node* node, vector<Node*>& nodes);
 
 public:
+    // In-order position in the tree. Holds the path from the root, so moving
+    // to the next key never copies a record. Any insert invalidates it.
+    class Cursor {
+    private:
+        static const int MAX_DEPTH = 32;
+
+        const Node* path[MAX_DEPTH];
+        int index[MAX_DEPTH];
+        int depth;
+
+        friend class BTree;
+
+        void push(const Node* node, int i) {
+            path[depth] = node;
+            index[depth] = i;
+            depth++;
+        }
+
+        // Drops finished frames so the top one points at an existing key.
+        void settle() {
+            while (depth > 0 && index[depth - 1] >= path[depth - 1]->numKeys) {
+                depth--;
+            }
+        }
+
+    public:
+        Cursor() : depth(0) {}
+
+        bool valid() const { return depth > 0; }
+        const K& key() const { return path[depth - 1]->keys[index[depth - 1]]; }
+        const V& value() const { return path[depth - 1]->values[index[depth - 1]]; }
+
+        void next() {
+            const Node* node = path[depth - 1];
+            int i = index[depth - 1];
+
+            if (node->isLeaf) {
+                index[depth - 1] = i + 1;
+                settle();
+                return;
+            }
+
+            index[depth - 1] = i + 1;
+            const Node* child = node->children[i + 1];
+            while (true) {
+                push(child, 0);
+                if (child->isLeaf) break;
+                child = child->children[0];
+            }
+            settle();
+        }
+    };
+
     BTree();
     ~BTree();
 
-    string search(int key);
-    void insert(int key, const string& value);
-    bool exists(int key);
-    bool update(int key, const string& value);
-    vector<pair<int, string>> traverseAll();
-    int getCount();
-    int getMaxKey();
+    BTree(const BTree&) = delete;
+    BTree& operator=(const BTree&) = delete;
+
+    const V* find(const K& key) const;
+    V* find(const K& key);
+    void insert(const K& key, const V& value);
+    bool exists(const K& key) const;
+    bool update(const K& key, const V& value);
+    vector<pair<K, V>> traverseAll() const;
+    int getCount() const { return entryCount; }
+    int getHeight() const;
+    K getMaxKey() const { return maxKey; }
+
+    Cursor begin() const;
+    Cursor lowerBound(const K& key) const;
+    Cursor select(int rank) const;
+    int rank(const K& key) const;
     bool isEmpty() const { return root == nullptr || root->numKeys == 0; }
     bool saveToFile(const string& filename);
     bool loadFromFile(const string& filename);
+
+    // Writes one NODE_ line of the .dat format. Shared with BTreeFileWriter,
+    // which streams files without building a tree in memory.
+    static void writeNodeRecord(ostream& file, int nodeId, bool isLeaf, const K* keys,
+                                const V* values, int numKeys, const int* childIds);
     void clear();
+    const Arena& getArena() const { return arena; }
+
+    void setFilterMode(KeyFilterMode mode);
+    const KeyFilter<K>& getFilter() const { return filter; }
 };
 
+template<typename K, typename V, int ORDER>
+BTree<K, V, ORDER>::BTree() : root(nullptr), nodeCounter(0), entryCount(0), maxKey() {}
+
+template<typename K, typename V, int ORDER>
+BTree<K, V, ORDER>::~BTree() {
+    clear();
+}
+
+template<typename K, typename V, int ORDER>
+void BTree<K, V, ORDER>::clear() {
+    // Only records that own memory need their destructors run; otherwise
+    // tearing the tree down is a single arena release.
+    if (root != nullptr &&
+        !(is_trivially_destructible<K>::value && is_trivially_destructible<V>::value)) {
+        vector<Node*> nodes;
+        collectNodes(root, nodes);
+        for (Node* node : nodes) {
+            node->destroy();
+        }
+    }
+    arena.release();
+    root = nullptr;
+    nodeCounter = 0;
+    entryCount = 0;
+    maxKey = K();
+    filter.reset(filter.getMode());
+}
+
+template<typename K, typename V, int ORDER>
+void BTree<K, V, ORDER>::setFilterMode(KeyFilterMode mode) {
+    filter.reset(mode, entryCount);
+    rebuildFilter();
+}
+
+template<typename K, typename V, int ORDER>
+void BTree<K, V, ORDER>::rebuildFilter() {
+    filter.reset(filter.getMode(), 2 * (size_t)entryCount);
+    if (!filter.isEnabled()) return;
+    for (Cursor it = begin(); it.valid(); it.next()) {
+        filter.add(it.key());
+    }
+}
+
+// Each level is split into the fewest nodes that hold it: with n keys
+// that is g = ceil((n + 1) / (MAX_KEYS + 1)) nodes, the g - 1 keys between
+// them move up as separators, and the rest are shared out evenly. That
+// leaves every node but the root with at least MIN_KEYS, the same
+// invariant the file writer keeps.
+template<typename K, typename V, int ORDER>
+void BTree<K, V, ORDER>::buildFromSorted(vector<pair<K, V>>& records) {
+    clear();
+    if (records.empty()) {
+        return;
+    }
+    maxKey = records.back().first;
+
+    vector<pair<K, V>> items(std::move(records));
+    vector<Node*> children;
+    bool leaf = true;
+    while (true) {
+        size_t count = items.size();
+        size_t groups = (count + 1 + Node::MAX_KEYS) / (Node::MAX_KEYS + 1);
+        size_t keysInNodes = count - (groups - 1);
+
+        vector<Node*> nodes;
+        vector<pair<K, V>> separators;
+        size_t item = 0, child = 0;
+        for (size_t g = 0; g < groups; g++) {
+            int numKeys = (int)(keysInNodes / groups + (g < keysInNodes % groups ? 1 : 0));
+            Node* node = Node::create(arena, leaf);
+            node->nodeId = nodeCounter++;
+            node->numKeys = numKeys;
+            for (int i = 0; i < numKeys; i++, item++) {
+                node->keys[i] = items[item].first;
+                node->values[i] = std::move(items[item].second);
+            }
+            if (!leaf) {
+                for (int i = 0; i <= numKeys; i++) {
+                    node->children[i] = children[child++];
+                }
+            }
+            nodes.push_back(node);
+            if (g + 1 < groups) {
+                separators.push_back(std::move(items[item++]));
+            }
+        }
+
+        if (groups == 1) {
+            root = nodes[0];
+            break;
+        }
+        items = std::move(separators);
+        children = std::move(nodes);
+        leaf = false;
+    }
+
+    entryCount = root->computeSubtreeSize();
+    rebuildFilter();
+}
+
+template<typename K, typename V, int ORDER>
+const V* BTree<K, V, ORDER>::find(const K& key) const {
+    if (root == nullptr || !filter.mayContain(key)) {
+        return nullptr;
+    }
+    return root->search(key);
+}
+
+template<typename K, typename V, int ORDER>
+V* BTree<K, V, ORDER>::find(const K& key) {
+    if (root == nullptr || !filter.mayContain(key)) {
+        return nullptr;
+    }
+    return root->search(key);
+}
+
+template<typename K, typename V, int ORDER>
+bool BTree<K, V, ORDER>::exists(const K& key) const {
+    return find(key) != nullptr;
+}
+
+template<typename K, typename V, int ORDER>
+void BTree<K, V, ORDER>::insert(const K& key, const V& value) {
+    if (entryCount == 0 || maxKey < key) {
+        maxKey = key;
+    }
+
+    if (root == nullptr) {
+        root = Node::create(arena, true);
+        root->keys[0] = key;
+        root->values[0] = value;
+        root->numKeys = 1;
+        root->subtreeSize = 1;
+        entryCount = 1;
+        filter.add(key);
+        return;
+    }
+
+    if (V* existing = find(key)) {
+        *existing = value;
+        return;
+    }
+
+    if (root->isFull()) {
+        Node* newRoot = Node::create(arena, false);
+        newRoot->children[0] = root;
+        newRoot->subtreeSize = root->subtreeSize;
+        newRoot->splitChild(0, arena);
+        root = newRoot;
+    }
+
+    root->insertNonFull(key, value, arena);
+    entryCount++;
+
+    filter.add(key);
+    if (filter.needsRebuild()) {
+        rebuildFilter();
+    }
+}
+
+template<typename K, typename V, int ORDER>
+bool BTree<K, V, ORDER>::update(const K& key, const V& value) {
+    V* existing = find(key);
+    if (existing == nullptr) {
+        return false;
+    }
+    *existing = value;
+    return true;
+}
+
+template<typename K, typename V, int ORDER>
+vector<pair<K, V>> BTree<K, V, ORDER>::traverseAll() const {
+    vector<pair<K, V>> result;
+    if (root != nullptr) {
+        root->traverse(result);
+    }
+    return result;
+}
+
+
+template<typename K, typename V, int ORDER>
+int BTree<K, V, ORDER>::getHeight() const {
+    int height = 0;
+    for (Node* current = root; current != nullptr;
+         current = current->isLeaf ? nullptr : current->children[0]) {
+        height++;
+    }
+    return height;
+}
+
+template<typename K, typename V, int ORDER>
+typename BTree<K, V, ORDER>::Cursor BTree<K, V, ORDER>::begin() const {
+    Cursor cursor;
+    for (const Node* node = root; node != nullptr;
+         node = node->isLeaf ? nullptr : node->children[0]) {
+        cursor.push(node, 0);
+    }
+    cursor.settle();
+    return cursor;
+}
+
+template<typename K, typename V, int ORDER>
+typename BTree<K, V, ORDER>::Cursor BTree<K, V, ORDER>::lowerBound(const K& key) const {
+    Cursor cursor;
+    const Node* node = root;
+    while (node != nullptr) {
+        int i = node->findKey(key);
+        cursor.push(node, i);
+
+        if ((i < node->numKeys && node->keys[i] == key) || node->isLeaf) {
+            break;
+        }
+        node = node->children[i];
+    }
+    cursor.settle();
+    return cursor;
+}
+
+// Positions a cursor on the key with the given 0-based rank, using the
+// per-node subtree sizes to skip whole children.
+template<typename K, typename V, int ORDER>
+typename BTree<K, V, ORDER>::Cursor BTree<K, V, ORDER>::select(int rank) const {
+    Cursor cursor;
+    if (rank < 0 || rank >= entryCount) {
+        return cursor;
+    }
+
+    const Node* node = root;
+    while (node != nullptr) {
+        int j = 0;
+        for (; j <= node->numKeys; j++) {
+            int size = node->childSize(j);
+            if (rank < size) {
+                break;
+            }
+            rank -= size;
+            if (j < node->numKeys) {
+                if (rank == 0) {
+                    cursor.push(node, j);
+                    return cursor;
+                }
+                rank--;
+            }
+        }
+        cursor.push(node, j);
+        node = node->isLeaf ? nullptr : node->children[j];
+    }
+    cursor.depth = 0;
+    return cursor;
+}
+
+// Number of keys strictly less than key.
+template<typename K, typename V, int ORDER>
+int BTree<K, V, ORDER>::rank(const K& key) const {
+    int result = 0;
+    const Node* node = root;
+    while (node != nullptr) {
+        int i = node->findKey(key);
+        for (int j = 0; j < i; j++) {
+            result += node->childSize(j);
+        }
+        result += i;
+
+        if (i < node->numKeys && node->keys[i] == key) {
+            return result + node->childSize(i);
+        }
+        node = node->isLeaf ? nullptr : node->children[i];
+    }
+    return result;
+}
+
+template<typename K, typename V, int ORDER>
+void BTree<K, V, ORDER>::collectNodes(Node* node, vector<Node*>& nodes) {
+    if (node == nullptr) return;
+
+    queue<Node*> q;
+    q.push(node);
+
+    while (!q.empty()) {
+        Node* current = q.front();
+        q.pop();
+        nodes.push_back(current);
+
+        if (!current->isLeaf) {
+            for (int i = 0; i <= current->numKeys; i++) {
+                if (current->children[i] != nullptr) {
+                    q.push(current->children[i]);
+                }
+            }
+        }
+    }
+}
+
+template<typename K, typename V, int ORDER>
+void BTree<K, V, ORDER>::assignNodeIds(Node* node, vector<Node*>& nodes) {
+    nodes.clear();
+    collectNodes(node, nodes);
+    for (int i = 0; i < (int)nodes.size(); i++) {
+        nodes[i]->nodeId = i;
+    }
+}
+
+template<typename K, typename V, int ORDER>
+void BTree<K, V, ORDER>::writeNodeRecord(ostream& file, int nodeId, bool isLeaf, const K* keys,
+                                         const V* values, int numKeys, const int* childIds) {
+    file << "NODE_" << nodeId << "|";
+    file << "LEAF=" << (isLeaf ? "true" : "false") << "|";
+
+    file << "KEYS=[";
+    for (int i = 0; i < numKeys; i++) {
+        if (i > 0) file << ",";
+        file << keys[i];
+    }
+    file << "]|";
+
+    file << "VALUES=[";
+    for (int i = 0; i < numKeys; i++) {
+        if (i > 0) file << "~";
+        string escaped = BTreeCodec<V>::encode(values[i]);
+        for (size_t pos = 0; (pos = escaped.find('|', pos)) != string::npos; pos += 2) {
+            escaped.replace(pos, 1, "\\|");
+        }
+        for (size_t pos = 0; (pos = escaped.find('[', pos)) != string::npos; pos += 2) {
+            escaped.replace(pos, 1, "\\[");
+        }
+        for (size_t pos = 0; (pos = escaped.find(']', pos)) != string::npos; pos += 2) {
+            escaped.replace(pos, 1, "\\]");
+        }
+        file << escaped;
+    }
+    file << "]";
+
+    if (!isLeaf) {
+        file << "|CHILDREN=[";
+        for (int i = 0; i <= numKeys; i++) {
+            if (i > 0) file << ",";
+            file << childIds[i];
+        }
+        file << "]";
+    }
+
+    file << "\n";
+}
+
+template<typename K, typename V, int ORDER>
+bool BTree<K, V, ORDER>::saveToFile(const string& filename) {
+    ofstream file(filename);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    if (root == nullptr) {
+        file << "ORDER=" << ORDER << "\n";
+        file << "ROOT_INDEX=-1\n";
+        file << "NODE_COUNT=0\n";
+        file.close();
+        return true;
+    }
+
+    vector<Node*> nodes;
+    assignNodeIds(root, nodes);
+
+    file << "ORDER=" << ORDER << "\n";
+    file << "ROOT_INDEX=0\n";
+    file << "NODE_COUNT=" << nodes.size() << "\n";
+    file << "\n";
+
+    vector<int> childIds(Node::MAX_KEYS + 1);
+    for (Node* node : nodes) {
+        if (!node->isLeaf) {
+            for (int i = 0; i <= node->numKeys; i++) {
+                childIds[i] = node->children[i] ? node->children[i]->nodeId : -1;
+            }
+        }
+        writeNodeRecord(file, node->nodeId, node->isLeaf, node->keys, node->values,
+                        node->numKeys, childIds.data());
+    }
+
+    file.close();
+    return true;
+}
+
+template<typename K, typename V, int ORDER>
+bool BTree<K, V, ORDER>::parseNodeLine(const string& line, ParsedNode& parsed) {
+    size_t pipePos = line.find('|');
+    if (pipePos == string::npos) {
+        parsed.nodeId = -1;
+        return false;
+    }
+    parsed.nodeId = stoi(line.substr(5, pipePos - 5));
+
+    string rest = line.substr(pipePos + 1);
+
+    parsed.isLeaf = rest.find("LEAF=true") != string::npos;
+    parsed.keys.clear();
+    parsed.values.clear();
+    parsed.children.clear();
+
+    size_t keysStart = rest.find("KEYS=[") + 6;
+    size_t keysEnd = rest.find("]", keysStart);
+    string keysStr = rest.substr(keysStart, keysEnd - keysStart);
+
+    if (!keysStr.empty()) {
+        if constexpr (is_integral<K>::value) {
+            // Integer keys are the common case and are read in place.
+            const char* next = keysStr.data();
+            const char* last = next + keysStr.size();
+            while (next < last) {
+                K key{};
+                next = from_chars(next, last, key).ptr;
+                parsed.keys.push_back(key);
+                while (next < last && *next++ != ',') {}
+            }
+        } else {
+            istringstream keysStream(keysStr);
+            string keyToken;
+            while (getline(keysStream, keyToken, ',')) {
+                istringstream keyStream(keyToken);
+                K key{};
+                keyStream >> key;
+                parsed.keys.push_back(key);
+            }
+        }
+    }
+
+    size_t valuesStart = rest.find("VALUES=[") + 8;
+    size_t valuesEnd = rest.find("]", valuesStart);
+    while (valuesEnd > 0 && rest[valuesEnd - 1] == '\\') {
+        valuesEnd = rest.find("]", valuesEnd + 1);
+    }
+    string valuesStr = rest.substr(valuesStart, valuesEnd - valuesStart);
+
+    if (!valuesStr.empty()) {
+        istringstream valuesStream(valuesStr);
+        string valueToken;
+        while (getline(valuesStream, valueToken, '~') && parsed.values.size() < parsed.keys.size()) {
+            string unescaped = valueToken;
+            for (size_t pos = 0; (pos = unescaped.find("\\|", pos)) != string::npos; pos += 1) {
+                unescaped.replace(pos, 2, "|");
+            }
+            for (size_t pos = 0; (pos = unescaped.find("\\[", pos)) != string::npos; pos += 1) {
+                unescaped.replace(pos, 2, "[");
+            }
+            for (size_t pos = 0; (pos = unescaped.find("\\]", pos)) != string::npos; pos += 1) {
+                unescaped.replace(pos, 2, "]");
+            }
+            parsed.values.push_back(BTreeCodec<V>::decode(parsed.keys[parsed.values.size()], unescaped));
+        }
+    }
+    parsed.values.resize(parsed.keys.size());
+
+    if (!parsed.isLeaf) {
+        size_t childStart = rest.find("CHILDREN=[");
+        if (childStart != string::npos) {
+            childStart += 10;
+            size_t childEnd = rest.find("]", childStart);
+            string childStr = rest.substr(childStart, childEnd - childStart);
+
+            istringstream childStream(childStr);
+            string childToken;
+            while (getline(childStream, childToken, ',')) {
+                parsed.children.push_back(stoi(childToken));
+            }
+        }
+    }
+
+    return true;
+}
+
+template<typename K, typename V, int ORDER>
+void BTree<K, V, ORDER>::parseBatch(const vector<string>& lines, vector<ParsedNode>& parsed) {
+    parsed.resize(lines.size());
+
+    size_t threads = thread::hardware_concurrency();
+    if (threads <= 1 || lines.size() < PARALLEL_PARSE_MIN_LINES) {
+        for (size_t i = 0; i < lines.size(); i++) {
+            parseNodeLine(lines[i], parsed[i]);
+        }
+        return;
+    }
+
+    threads = min(threads, lines.size() / (PARALLEL_PARSE_MIN_LINES / 4));
+    size_t perThread = (lines.size() + threads - 1) / threads;
+    vector<thread> workers;
+    for (size_t t = 0; t < threads; t++) {
+        size_t begin = t * perThread;
+        size_t end = min(lines.size(), begin + perThread);
+        workers.emplace_back([&lines, &parsed, begin, end] {
+            for (size_t i = begin; i < end; i++) {
+                parseNodeLine(lines[i], parsed[i]);
+            }
+        });
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+}
+
+template<typename K, typename V, int ORDER>
+bool BTree<K, V, ORDER>::loadFromFile(const string& filename) {
+    ifstream file(filename);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    clear();
+
+    string line;
+    int order = 0, rootIndex = -1, nodeCount = 0;
+
+    while (getline(file, line) && !line.empty()) {
+        if (line.find("ORDER=") == 0) {
+            order = stoi(line.substr(6));
+        } else if (line.find("ROOT_INDEX=") == 0) {
+            rootIndex = stoi(line.substr(11));
+        } else if (line.find("NODE_COUNT=") == 0) {
+            nodeCount = stoi(line.substr(11));
+        }
+    }
+
+    if (nodeCount == 0 || rootIndex < 0) {
+        file.close();
+        return true;
+    }
+
+    // Only a file written with our own order is linked up node for node.
+    // Any other order is rebuilt from its records: wider nodes would not
+    // fit, and narrower ones would keep the old, taller shape for good,
+    // since saveToFile writes back whatever is in memory.
+    bool rebuild = order != ORDER;
+    vector<pair<K, V>> records;
+
+    vector<Node*> nodes(nodeCount, nullptr);
+    vector<vector<int>> childIndices(nodeCount);
+
+    // Lines are parsed a batch at a time across threads; nodes are then
+    // placed in the arena on this thread, since the arena is not shared.
+    vector<string> batch;
+    vector<ParsedNode> parsed;
+    bool more = true;
+
+    while (more) {
+        batch.clear();
+        while (batch.size() < LOAD_BATCH_LINES && (more = (bool)getline(file, line))) {
+            if (line.empty() || line.find("NODE_") != 0) continue;
+            batch.push_back(std::move(line));
+        }
+        parseBatch(batch, parsed);
+
+        for (ParsedNode& record : parsed) {
+            int nodeId = record.nodeId;
+            if (nodeId < 0 || nodeId >= nodeCount) continue;
+
+            if (rebuild || (int)record.keys.size() > Node::MAX_KEYS) {
+                rebuild = true;
+                for (size_t i = 0; i < record.keys.size(); i++) {
+                    records.push_back({record.keys[i], std::move(record.values[i])});
+                }
+                continue;
+            }
+
+            Node* node = Node::create(arena, record.isLeaf);
+            node->nodeId = nodeId;
+            node->numKeys = (int)record.keys.size();
+            for (int i = 0; i < node->numKeys; i++) {
+                node->keys[i] = record.keys[i];
+                node->values[i] = std::move(record.values[i]);
+            }
+
+            if (!record.isLeaf) {
+                childIndices[nodeId] = std::move(record.children);
+            }
+
+            nodes[nodeId] = node;
+        }
+    }
+
+    if (rebuild) {
+        file.close();
+        for (Node* node : nodes) {
+            if (node == nullptr) continue;
+            for (int i = 0; i < node->numKeys; i++) {
+                records.push_back({node->keys[i], std::move(node->values[i])});
+            }
+            node->destroy();
+        }
+        stable_sort(records.begin(), records.end(),
+                    [](const pair<K, V>& a, const pair<K, V>& b) { return a.first < b.first; });
+        // A duplicated key keeps its last copy, as re-inserting would.
+        vector<pair<K, V>> unique;
+        unique.reserve(records.size());
+        for (auto& record : records) {
+            if (!unique.empty() && !(unique.back().first < record.first)) {
+                unique.back() = std::move(record);
+            } else {
+                unique.push_back(std::move(record));
+            }
+        }
+        buildFromSorted(unique);
+        return true;
+    }
+
+    file.close();
+
+    for (int i = 0; i < nodeCount; i++) {
+        if (nodes[i] != nullptr && !nodes[i]->isLeaf) {
+            for (int j = 0; j < (int)childIndices[i].size(); j++) {
+                int childIdx = childIndices[i][j];
+                if (childIdx >= 0 && childIdx < nodeCount) {
+                    nodes[i]->children[j] = nodes[childIdx];
+                }
+            }
+        }
+    }
+
+    if (rootIndex >= 0 && rootIndex < nodeCount) {
+        root = nodes[rootIndex];
+    }
+
+    if (root != nullptr) {
+        entryCount = root->computeSubtreeSize();
+        rebuildFilter();
+        const Node* current = root;
+        while (!current->isLeaf) {
+            current = current->children[current->numKeys];
+        }
+        if (current->numKeys > 0) {
+            maxKey = current->keys[current->numKeys - 1];
+        }
+    }
+
+    return true;
+}
+
 #endif
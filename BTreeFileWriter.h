@@ -0,0 +1,199 @@
+#ifndef BTREE_FILE_WRITER_H
+#define BTREE_FILE_WRITER_H
+
+#include "BTree.h"
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+
+using namespace std;
+
+// Streams a B-tree .dat file from records given in strictly increasing key
+// order, without building the tree in memory. Nodes are filled bottom-up:
+// a leaf takes MAX_KEYS records, the next record becomes the separator in
+// its parent, and so on up the levels. Only the open node and the last
+// closed node of each level are held, so memory is O(height * ORDER).
+//
+// On close() the open node on the right edge of each level may be
+// underfull; it is evened out with its left sibling through their parent
+// separator, so every node but the root keeps at least MIN_KEYS. The
+// header is written with fixed-width placeholders and patched at the end,
+// since the root is the last node to be closed.
+template<typename K, typename V, int ORDER = BTREE_ORDER>
+class BTreeFileWriter {
+private:
+    static const int MAX_KEYS = 2 * ORDER - 1;
+    static const int MIN_KEYS = ORDER - 1;
+
+    struct PendingNode {
+        int nodeId;
+        vector<K> keys;
+        vector<V> values;
+        vector<int> children;
+
+        PendingNode() : nodeId(-1) {}
+    };
+
+    struct Level {
+        PendingNode open;
+        PendingNode closed;
+        bool hasClosed;
+
+        Level() : hasClosed(false) {}
+    };
+
+    ofstream file;
+    streampos headerPos;
+    vector<Level> levels;
+    int nodeCount;
+    long long recordCount;
+    K lastKey;
+    bool ordered;
+
+    void writeNode(const PendingNode& node, bool isLeaf) {
+        BTree<K, V, ORDER>::writeNodeRecord(file, node.nodeId, isLeaf, node.keys.data(),
+                                            node.values.data(), (int)node.keys.size(),
+                                            node.children.data());
+    }
+
+    void writeHeader(int rootId, int count) {
+        char header[96];
+        snprintf(header, sizeof(header), "ORDER=%d\nROOT_INDEX=%010d\nNODE_COUNT=%010d\n\n",
+                 ORDER, rootId, count);
+        file << header;
+    }
+
+    // Adds a record to the open node at the given level. When that node is
+    // full it is closed and the record moves up as the separator between
+    // it and the next node.
+    void push(size_t level, const K& key, const V& value) {
+        if (level == levels.size()) {
+            levels.emplace_back();
+        }
+
+        Level& current = levels[level];
+        if ((int)current.open.keys.size() < MAX_KEYS) {
+            current.open.keys.push_back(key);
+            current.open.values.push_back(value);
+            return;
+        }
+
+        if (current.hasClosed) {
+            writeNode(current.closed, level == 0);
+        }
+        current.open.nodeId = nodeCount++;
+        swap(current.closed, current.open);
+        current.hasClosed = true;
+        current.open = PendingNode();
+
+        int closedId = current.closed.nodeId;
+        if (level + 1 == levels.size()) {
+            levels.emplace_back();
+        }
+        levels[level + 1].open.children.push_back(closedId);
+        push(level + 1, key, value);
+    }
+
+    // Moves keys (and children) between two siblings so both end up with
+    // at least MIN_KEYS, replacing their separator in the parent.
+    static void rebalance(PendingNode& left, PendingNode& right, PendingNode& parent) {
+        vector<K> keys(move(left.keys));
+        vector<V> values(move(left.values));
+        keys.push_back(parent.keys.back());
+        values.push_back(parent.values.back());
+        parent.keys.pop_back();
+        parent.values.pop_back();
+        keys.insert(keys.end(), right.keys.begin(), right.keys.end());
+        values.insert(values.end(), right.values.begin(), right.values.end());
+
+        vector<int> children(move(left.children));
+        children.insert(children.end(), right.children.begin(), right.children.end());
+
+        size_t leftCount = (keys.size() - 1) / 2;
+        left.keys.assign(keys.begin(), keys.begin() + leftCount);
+        left.values.assign(values.begin(), values.begin() + leftCount);
+        parent.keys.push_back(keys[leftCount]);
+        parent.values.push_back(values[leftCount]);
+        right.keys.assign(keys.begin() + leftCount + 1, keys.end());
+        right.values.assign(values.begin() + leftCount + 1, values.end());
+
+        if (!children.empty()) {
+            left.children.assign(children.begin(), children.begin() + leftCount + 1);
+            right.children.assign(children.begin() + leftCount + 1, children.end());
+        }
+    }
+
+public:
+    BTreeFileWriter() : nodeCount(0), recordCount(0), lastKey(), ordered(true) {}
+
+    bool open(const string& filename) {
+        file.open(filename, ios::out | ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        levels.clear();
+        nodeCount = 0;
+        recordCount = 0;
+        ordered = true;
+
+        headerPos = file.tellp();
+        writeHeader(-1, 0);
+        return file.good();
+    }
+
+    // Keys must be strictly increasing; an out-of-order key is dropped and
+    // makes close() fail.
+    void add(const K& key, const V& value) {
+        if (recordCount > 0 && !(lastKey < key)) {
+            ordered = false;
+            return;
+        }
+        lastKey = key;
+        recordCount++;
+        push(0, key, value);
+    }
+
+    long long getRecordCount() const { return recordCount; }
+
+    bool close() {
+        if (!file.is_open()) {
+            return false;
+        }
+
+        int rootId = -1;
+        if (recordCount > 0) {
+            for (size_t level = 0; level < levels.size(); level++) {
+                if (level > 0) {
+                    levels[level].open.children.push_back(levels[level - 1].open.nodeId);
+                }
+                levels[level].open.nodeId = nodeCount++;
+            }
+
+            // Top-down, so a parent emptied by its own split has been
+            // refilled before its children look for their separator.
+            for (size_t level = levels.size() - 1; level-- > 0; ) {
+                Level& current = levels[level];
+                if (current.hasClosed && (int)current.open.keys.size() < MIN_KEYS) {
+                    rebalance(current.closed, current.open, levels[level + 1].open);
+                }
+            }
+
+            for (size_t level = 0; level < levels.size(); level++) {
+                if (levels[level].hasClosed) {
+                    writeNode(levels[level].closed, level == 0);
+                }
+                writeNode(levels[level].open, level == 0);
+            }
+            rootId = levels.back().open.nodeId;
+        }
+
+        file.seekp(headerPos);
+        writeHeader(rootId, nodeCount);
+        file.close();
+        levels.clear();
+        return ordered && !file.fail();
+    }
+};
+
+#endif
@@ -3,36 +3,260 @@
 
 #include <string>
 #include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <new>
+#include "Arena.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    #include <immintrin.h>
+#endif
 
 using namespace std;
 
-const int BTREE_ORDER = 3;
-const int MAX_KEYS = 2 * BTREE_ORDER - 1;
-const int MIN_KEYS = BTREE_ORDER - 1;
+// Default minimum degree. A node holds up to 2 * ORDER - 1 keys, so with
+// int keys the key array of a full node spans four 64-byte cache lines.
+const int BTREE_ORDER = 32;
+
+// Returns the index of the first key in keys[0..numKeys) that is not less
+// than key. Keys are kept sorted and unique, so the keys below the target
+// form a prefix and the vector paths can stop at the first partial block.
+template<typename K>
+inline int btreeLowerBound(const K* keys, int numKeys, const K& key) {
+    return (int)(lower_bound(keys, keys + numKeys, key) - keys);
+}
+
+inline int btreeLowerBound(const int32_t* keys, int numKeys, const int32_t& key) {
+    int i = 0;
+#if defined(__AVX2__)
+    __m256i target = _mm256_set1_epi32(key);
+    for (; i + 8 <= numKeys; i += 8) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(keys + i));
+        unsigned mask = (unsigned)_mm256_movemask_ps(
+            _mm256_castsi256_ps(_mm256_cmpgt_epi32(target, block)));
+        if (mask != 0xFFu) {
+            return i + __builtin_ctz(~mask);
+        }
+    }
+#elif defined(__SSE2__)
+    __m128i target = _mm_set1_epi32(key);
+    for (; i + 4 <= numKeys; i += 4) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(keys + i));
+        unsigned mask = (unsigned)_mm_movemask_ps(
+            _mm_castsi128_ps(_mm_cmpgt_epi32(target, block)));
+        if (mask != 0xFu) {
+            return i + __builtin_ctz(~mask);
+        }
+    }
+#endif
+    while (i < numKeys && keys[i] < key) {
+        i++;
+    }
+    return i;
+}
+
+inline int btreeLowerBound(const int64_t* keys, int numKeys, const int64_t& key) {
+    int i = 0;
+#if defined(__AVX2__)
+    __m256i target = _mm256_set1_epi64x(key);
+    for (; i + 4 <= numKeys; i += 4) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(keys + i));
+        unsigned mask = (unsigned)_mm256_movemask_pd(
+            _mm256_castsi256_pd(_mm256_cmpgt_epi64(target, block)));
+        if (mask != 0xFu) {
+            return i + __builtin_ctz(~mask);
+        }
+    }
+#endif
+    while (i < numKeys && keys[i] < key) {
+        i++;
+    }
+    return i;
+}
 
-class BTreeNode {
+// Keys sit at the front of the node, with the child pointers behind them;
+// values live in a separate array so a search only touches key cache lines.
+// Nodes and value arrays are carved out of the owning tree's Arena, so they
+// are never deleted one by one: destroy() runs destructors and the tree
+// releases the arena.
+template<typename K, typename V, int ORDER = BTREE_ORDER>
+class alignas(64) BTreeNode {
 public:
-    bool isLeaf;
+    static const int MAX_KEYS = 2 * ORDER - 1;
+    static const int MIN_KEYS = ORDER - 1;
+
+    K keys[MAX_KEYS];
     int numKeys;
-    int keys[MAX_KEYS];
-    string values[MAX_KEYS];
-    BTreeNode* children[MAX_KEYS + 1];
+    int subtreeSize;
+    bool isLeaf;
     int nodeId;
+    BTreeNode* children[MAX_KEYS + 1];
+    V* values;
+
+    BTreeNode(bool leaf, V* valueStorage);
 
-    BTreeNode(bool leaf = true);
-    ~BTreeNode();
+    BTreeNode(const BTreeNode&) = delete;
+    BTreeNode& operator=(const BTreeNode&) = delete;
 
-    string search(int key);
-    void insertNonFull(int key, const string& value);
-    void splitChild(int index);
-    void traverse(vector<pair<int, string>>& result);
-    int findKey(int key);
+    static BTreeNode* create(Arena& arena, bool leaf);
+    void destroy();
+
+    V* search(const K& key);
+    void insertNonFull(const K& key, const V& value, Arena& arena);
+    void splitChild(int index, Arena& arena);
+    void traverse(vector<pair<K, V>>& result) const;
+    int computeSubtreeSize();
+    int childSize(int index) const { return isLeaf ? 0 : children[index]->subtreeSize; }
+    int findKey(const K& key) const { return btreeLowerBound(keys, numKeys, key); }
 
     bool isFull() const { return numKeys == MAX_KEYS; }
     bool hasMinKeys() const { return numKeys == MIN_KEYS; }
-
-    string serialize() const;
-    static BTreeNode* deserialize(const string& data);
 };
 
+template<typename K, typename V, int ORDER>
+BTreeNode<K, V, ORDER>::BTreeNode(bool leaf, V* valueStorage)
+    : numKeys(0), subtreeSize(0), isLeaf(leaf), nodeId(-1), values(valueStorage) {
+    for (int i = 0; i <= MAX_KEYS; i++) {
+        children[i] = nullptr;
+    }
+}
+
+template<typename K, typename V, int ORDER>
+BTreeNode<K, V, ORDER>* BTreeNode<K, V, ORDER>::create(Arena& arena, bool leaf) {
+    V* valueStorage = static_cast<V*>(arena.allocate(sizeof(V) * MAX_KEYS, alignof(V)));
+    for (int i = 0; i < MAX_KEYS; i++) {
+        new (&valueStorage[i]) V();
+    }
+    void* memory = arena.allocate(sizeof(BTreeNode), alignof(BTreeNode));
+    return new (memory) BTreeNode(leaf, valueStorage);
+}
+
+template<typename K, typename V, int ORDER>
+void BTreeNode<K, V, ORDER>::destroy() {
+    if (!is_trivially_destructible<V>::value) {
+        for (int i = 0; i < MAX_KEYS; i++) {
+            values[i].~V();
+        }
+    }
+    this->~BTreeNode();
+}
+
+template<typename K, typename V, int ORDER>
+V* BTreeNode<K, V, ORDER>::search(const K& key) {
+    BTreeNode* node = this;
+    while (true) {
+        int i = node->findKey(key);
+
+        if (i < node->numKeys && node->keys[i] == key) {
+            return &node->values[i];
+        }
+
+        if (node->isLeaf) {
+            return nullptr;
+        }
+
+        node = node->children[i];
+    }
+}
+
+template<typename K, typename V, int ORDER>
+void BTreeNode<K, V, ORDER>::insertNonFull(const K& key, const V& value, Arena& arena) {
+    int i = findKey(key);
+    subtreeSize++;
+
+    if (isLeaf) {
+        for (int j = numKeys; j > i; j--) {
+            keys[j] = keys[j - 1];
+            values[j] = std::move(values[j - 1]);
+        }
+
+        keys[i] = key;
+        values[i] = value;
+        numKeys++;
+    } else {
+        if (children[i]->isFull()) {
+            splitChild(i, arena);
+
+            if (keys[i] < key) {
+                i++;
+            }
+        }
+
+        children[i]->insertNonFull(key, value, arena);
+    }
+}
+
+template<typename K, typename V, int ORDER>
+void BTreeNode<K, V, ORDER>::splitChild(int index, Arena& arena) {
+    BTreeNode* fullChild = children[index];
+    BTreeNode* newChild = create(arena, fullChild->isLeaf);
+
+    int mid = ORDER - 1;
+
+    newChild->numKeys = ORDER - 1;
+    for (int j = 0; j < ORDER - 1; j++) {
+        newChild->keys[j] = fullChild->keys[mid + 1 + j];
+        newChild->values[j] = std::move(fullChild->values[mid + 1 + j]);
+    }
+
+    if (!fullChild->isLeaf) {
+        for (int j = 0; j < ORDER; j++) {
+            newChild->children[j] = fullChild->children[mid + 1 + j];
+            fullChild->children[mid + 1 + j] = nullptr;
+        }
+    }
+
+    fullChild->numKeys = ORDER - 1;
+
+    newChild->subtreeSize = newChild->numKeys;
+    for (int j = 0; !newChild->isLeaf && j <= newChild->numKeys; j++) {
+        newChild->subtreeSize += newChild->children[j]->subtreeSize;
+    }
+    fullChild->subtreeSize -= newChild->subtreeSize + 1;
+
+    for (int j = numKeys; j > index; j--) {
+        children[j + 1] = children[j];
+    }
+    children[index + 1] = newChild;
+
+    for (int j = numKeys - 1; j >= index; j--) {
+        keys[j + 1] = keys[j];
+        values[j + 1] = std::move(values[j]);
+    }
+
+    keys[index] = fullChild->keys[mid];
+    values[index] = std::move(fullChild->values[mid]);
+    numKeys++;
+}
+
+template<typename K, typename V, int ORDER>
+int BTreeNode<K, V, ORDER>::computeSubtreeSize() {
+    subtreeSize = numKeys;
+    if (!isLeaf) {
+        for (int i = 0; i <= numKeys; i++) {
+            if (children[i] != nullptr) {
+                subtreeSize += children[i]->computeSubtreeSize();
+            }
+        }
+    }
+    return subtreeSize;
+}
+
+template<typename K, typename V, int ORDER>
+void BTreeNode<K, V, ORDER>::traverse(vector<pair<K, V>>& result) const {
+    int i;
+    for (i = 0; i < numKeys; i++) {
+        if (!isLeaf && children[i] != nullptr) {
+            children[i]->traverse(result);
+        }
+        result.push_back({keys[i], values[i]});
+    }
+
+    if (!isLeaf && children[i] != nullptr) {
+        children[i]->traverse(result);
+    }
+}
+
 #endif
@@ -0,0 +1,38 @@
+#ifndef CANCELLATION_TOKEN_H
+#define CANCELLATION_TOKEN_H
+
+#include <atomic>
+#include <chrono>
+
+using namespace std;
+
+// Tells long-running work that its answer is no longer wanted, either
+// because the requester went away or because the request's deadline has
+// passed. The cancelled flag belongs to whoever can notice the requester
+// leaving and must outlive the token. Copying a token is cheap. Checking
+// one costs an atomic load, plus a clock read when there is a deadline.
+struct CancellationToken {
+    typedef chrono::steady_clock Clock;
+
+    const atomic<bool>* cancelled;
+    Clock::time_point deadline;
+
+    CancellationToken() : cancelled(nullptr), deadline(Clock::time_point::max()) {}
+
+    CancellationToken(const atomic<bool>* flag, Clock::time_point until)
+        : cancelled(flag), deadline(until) {}
+
+    bool hasDeadline() const { return deadline != Clock::time_point::max(); }
+
+    bool isCancelled() const {
+        return cancelled != nullptr && cancelled->load(memory_order_relaxed);
+    }
+
+    bool isExpired() const {
+        return hasDeadline() && Clock::now() >= deadline;
+    }
+
+    bool shouldStop() const { return isCancelled() || isExpired(); }
+};
+
+#endif
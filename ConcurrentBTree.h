@@ -0,0 +1,414 @@
+#ifndef CONCURRENT_BTREE_H
+#define CONCURRENT_BTREE_H
+
+#include "EpochReclaimer.h"
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <type_traits>
+
+using namespace std;
+
+// Thread-safe B+-tree using optimistic lock coupling.
+//
+// Every node carries a version word: bit 1 is the write latch and each
+// unlock advances the version. Readers never write to nodes; they note the
+// version of a node, read it, and restart if the version has moved.
+// Writers descend the same way and latch only the nodes they modify (a leaf,
+// plus its parent when a split has to publish a separator), splitting full
+// inner nodes on the way down so a latch never has to be held above a parent.
+//
+// Small trivially copyable values are stored inline in atomic slots. Other
+// values are immutable heap objects referenced from the leaves, so a reader
+// can copy one after validation without racing a writer. Every traversal
+// pins an epoch (see EpochReclaimer), so replaced values and nodes dropped
+// by clear() are freed once no traversal that could have reached them is
+// still running. Keys must be trivially copyable.
+template<typename K, typename V, int FANOUT = 64>
+class ConcurrentBTree {
+private:
+    static const int MAX_KEYS = FANOUT - 1;
+    static const uint64_t LOCKED = 2;
+    static const bool INLINE_VALUES =
+        is_trivially_copyable<V>::value && sizeof(V) <= sizeof(void*);
+
+    typedef typename conditional<INLINE_VALUES, V, const V*>::type Slot;
+
+    struct Node {
+        atomic<uint64_t> version;
+        atomic<int> count;
+        const bool isLeaf;
+        atomic<K> keys[MAX_KEYS];
+
+        explicit Node(bool leaf) : version(0), count(0), isLeaf(leaf) {}
+        bool isFull() const { return count.load(memory_order_relaxed) == MAX_KEYS; }
+    };
+
+    struct Inner : Node {
+        atomic<Node*> children[MAX_KEYS + 1];
+        Inner() : Node(false) {
+            for (auto& child : children) child.store(nullptr, memory_order_relaxed);
+        }
+    };
+
+    struct Leaf : Node {
+        atomic<Slot> values[MAX_KEYS];
+        Leaf() : Node(true) {
+            for (auto& value : values) value.store(Slot(), memory_order_relaxed);
+        }
+    };
+
+    atomic<Node*> root;
+    atomic<long long> entryCount;
+    mutable EpochReclaimer reclaimer;
+
+    // Branch-free binary search: the comparison feeds a conditional move, so
+    // an unpredictable key does not cost a mispredict per level.
+    static int lowerBound(const Node* node, const K& key) {
+        int count = node->count.load(memory_order_relaxed);
+        if (count > MAX_KEYS) count = MAX_KEYS;
+        if (count == 0) return 0;
+
+        int base = 0;
+        while (count > 1) {
+            int half = count / 2;
+            base = (node->keys[base + half - 1].load(memory_order_relaxed) < key) ? base + half : base;
+            count -= half;
+        }
+        return base + (node->keys[base].load(memory_order_relaxed) < key ? 1 : 0);
+    }
+
+    static uint64_t readLock(const Node* node, bool& restart) {
+        uint64_t version = node->version.load(memory_order_acquire);
+        if (version & LOCKED) {
+            this_thread::yield();
+            restart = true;
+        }
+        return version;
+    }
+
+    static void checkVersion(const Node* node, uint64_t version, bool& restart) {
+        atomic_thread_fence(memory_order_acquire);
+        if (node->version.load(memory_order_relaxed) != version) {
+            restart = true;
+        }
+    }
+
+    static void upgradeToWriteLock(Node* node, uint64_t version, bool& restart) {
+        if (!node->version.compare_exchange_strong(version, version + LOCKED,
+                                                   memory_order_acquire)) {
+            restart = true;
+        }
+    }
+
+    static void writeUnlock(Node* node) {
+        node->version.fetch_add(LOCKED, memory_order_release);
+    }
+
+    static Node* childAt(const Node* node, int index) {
+        return static_cast<const Inner*>(node)->children[index].load(memory_order_acquire);
+    }
+
+    // Moves the upper half of a full node into a new sibling and returns the
+    // separator to publish in the parent. Caller holds the node's latch.
+    static Node* split(Node* node, K& separator) {
+        int count = node->count.load(memory_order_relaxed);
+        int mid = count / 2;
+
+        if (node->isLeaf) {
+            Leaf* leaf = static_cast<Leaf*>(node);
+            Leaf* right = new Leaf();
+            int moved = count - mid;
+            for (int i = 0; i < moved; i++) {
+                right->keys[i].store(leaf->keys[mid + i].load(memory_order_relaxed), memory_order_relaxed);
+                right->values[i].store(leaf->values[mid + i].load(memory_order_relaxed), memory_order_relaxed);
+            }
+            right->count.store(moved, memory_order_relaxed);
+            leaf->count.store(mid, memory_order_relaxed);
+            separator = leaf->keys[mid - 1].load(memory_order_relaxed);
+            return right;
+        }
+
+        Inner* inner = static_cast<Inner*>(node);
+        Inner* right = new Inner();
+        int moved = count - mid - 1;
+        for (int i = 0; i < moved; i++) {
+            right->keys[i].store(inner->keys[mid + 1 + i].load(memory_order_relaxed), memory_order_relaxed);
+        }
+        for (int i = 0; i <= moved; i++) {
+            right->children[i].store(inner->children[mid + 1 + i].load(memory_order_relaxed), memory_order_relaxed);
+        }
+        right->count.store(moved, memory_order_relaxed);
+        separator = inner->keys[mid].load(memory_order_relaxed);
+        inner->count.store(mid, memory_order_relaxed);
+        return right;
+    }
+
+    static void insertChild(Inner* inner, const K& separator, Node* child) {
+        int count = inner->count.load(memory_order_relaxed);
+        int pos = lowerBound(inner, separator);
+        for (int i = count; i > pos; i--) {
+            inner->keys[i].store(inner->keys[i - 1].load(memory_order_relaxed), memory_order_relaxed);
+            inner->children[i + 1].store(inner->children[i].load(memory_order_relaxed), memory_order_relaxed);
+        }
+        inner->keys[pos].store(separator, memory_order_relaxed);
+        inner->children[pos + 1].store(child, memory_order_release);
+        inner->count.store(count + 1, memory_order_relaxed);
+    }
+
+    void makeRoot(const K& separator, Node* left, Node* right) {
+        Inner* newRoot = new Inner();
+        newRoot->keys[0].store(separator, memory_order_relaxed);
+        newRoot->children[0].store(left, memory_order_relaxed);
+        newRoot->children[1].store(right, memory_order_relaxed);
+        newRoot->count.store(1, memory_order_relaxed);
+        root.store(newRoot, memory_order_release);
+    }
+
+    static Slot makeSlot(const V& value) {
+        if constexpr (INLINE_VALUES) {
+            return value;
+        } else {
+            return new V(value);
+        }
+    }
+
+    static void readSlot(const Slot& slot, V& out) {
+        if constexpr (INLINE_VALUES) {
+            out = slot;
+        } else {
+            out = *slot;
+        }
+    }
+
+    static void freeSlot(const Slot& slot) {
+        if constexpr (!INLINE_VALUES) {
+            delete slot;
+        }
+    }
+
+    void retireSlot(const Slot& slot) {
+        if constexpr (!INLINE_VALUES) {
+            reclaimer.retire(const_cast<V*>(slot), [](void* value) { delete static_cast<V*>(value); });
+        }
+    }
+
+    static void destroy(Node* node) {
+        if (node == nullptr) return;
+        if (node->isLeaf) {
+            Leaf* leaf = static_cast<Leaf*>(node);
+            int count = leaf->count.load(memory_order_relaxed);
+            for (int i = 0; i < count; i++) {
+                freeSlot(leaf->values[i].load(memory_order_relaxed));
+            }
+            delete leaf;
+        } else {
+            Inner* inner = static_cast<Inner*>(node);
+            int count = inner->count.load(memory_order_relaxed);
+            for (int i = 0; i <= count; i++) {
+                destroy(inner->children[i].load(memory_order_relaxed));
+            }
+            delete inner;
+        }
+    }
+
+    // Body of insert(); the caller holds an epoch guard. Returns false when
+    // key was present, with the value it displaced in replaced.
+    bool insertPinned(const K& key, Slot stored, Slot& replaced) {
+        while (true) {
+            bool restart = false;
+            Node* node = root.load(memory_order_acquire);
+            uint64_t version = readLock(node, restart);
+            if (restart) continue;
+
+            Node* parent = nullptr;
+            uint64_t parentVersion = 0;
+
+            while (!node->isLeaf) {
+                if (node->isFull()) {
+                    if (parent) {
+                        upgradeToWriteLock(parent, parentVersion, restart);
+                        if (restart) break;
+                    }
+                    upgradeToWriteLock(node, version, restart);
+                    if (restart) {
+                        if (parent) writeUnlock(parent);
+                        break;
+                    }
+                    if (!parent && node != root.load(memory_order_acquire)) {
+                        writeUnlock(node);
+                        restart = true;
+                        break;
+                    }
+
+                    K separator;
+                    Node* sibling = split(node, separator);
+                    if (parent) {
+                        insertChild(static_cast<Inner*>(parent), separator, sibling);
+                    } else {
+                        makeRoot(separator, node, sibling);
+                    }
+                    writeUnlock(node);
+                    if (parent) writeUnlock(parent);
+                    restart = true;
+                    break;
+                }
+
+                if (parent) {
+                    checkVersion(parent, parentVersion, restart);
+                    if (restart) break;
+                }
+
+                parent = node;
+                parentVersion = version;
+
+                node = childAt(parent, lowerBound(parent, key));
+                checkVersion(parent, parentVersion, restart);
+                if (restart || node == nullptr) {
+                    restart = true;
+                    break;
+                }
+
+                version = readLock(node, restart);
+                if (restart) break;
+            }
+            if (restart) continue;
+
+            Leaf* leaf = static_cast<Leaf*>(node);
+            upgradeToWriteLock(leaf, version, restart);
+            if (restart) continue;
+
+            int count = leaf->count.load(memory_order_relaxed);
+            int pos = lowerBound(leaf, key);
+
+            if (pos < count && leaf->keys[pos].load(memory_order_relaxed) == key) {
+                replaced = leaf->values[pos].exchange(stored, memory_order_acq_rel);
+                writeUnlock(leaf);
+                return false;
+            }
+
+            if (count == MAX_KEYS) {
+                if (parent) {
+                    upgradeToWriteLock(parent, parentVersion, restart);
+                    if (restart) {
+                        writeUnlock(leaf);
+                        continue;
+                    }
+                }
+                if (!parent && leaf != root.load(memory_order_acquire)) {
+                    writeUnlock(leaf);
+                    continue;
+                }
+
+                K separator;
+                Node* sibling = split(leaf, separator);
+                if (parent) {
+                    insertChild(static_cast<Inner*>(parent), separator, sibling);
+                } else {
+                    makeRoot(separator, leaf, sibling);
+                }
+                writeUnlock(leaf);
+                if (parent) writeUnlock(parent);
+                continue;
+            }
+
+            if (parent) {
+                checkVersion(parent, parentVersion, restart);
+                if (restart) {
+                    writeUnlock(leaf);
+                    continue;
+                }
+            }
+
+            for (int i = count; i > pos; i--) {
+                leaf->keys[i].store(leaf->keys[i - 1].load(memory_order_relaxed), memory_order_relaxed);
+                leaf->values[i].store(leaf->values[i - 1].load(memory_order_relaxed), memory_order_relaxed);
+            }
+            leaf->keys[pos].store(key, memory_order_relaxed);
+            leaf->values[pos].store(stored, memory_order_release);
+            leaf->count.store(count + 1, memory_order_relaxed);
+            writeUnlock(leaf);
+            return true;
+        }
+    }
+
+public:
+    ConcurrentBTree() : root(new Leaf()), entryCount(0) {}
+
+    // Retired objects still pending are freed by the reclaimer's destructor.
+    ~ConcurrentBTree() {
+        destroy(root.load());
+    }
+
+    ConcurrentBTree(const ConcurrentBTree&) = delete;
+    ConcurrentBTree& operator=(const ConcurrentBTree&) = delete;
+
+    // Copies the value stored under key into out. Never blocks writers.
+    bool lookup(const K& key, V& out) const {
+        EpochReclaimer::Guard guard(reclaimer);
+        while (true) {
+            bool restart = false;
+            Node* node = root.load(memory_order_acquire);
+            uint64_t version = readLock(node, restart);
+            if (restart) continue;
+
+            while (!node->isLeaf) {
+                Node* parent = node;
+                uint64_t parentVersion = version;
+
+                node = childAt(parent, lowerBound(parent, key));
+                checkVersion(parent, parentVersion, restart);
+                if (restart || node == nullptr) break;
+
+                version = readLock(node, restart);
+                if (restart) break;
+            }
+            if (restart || node == nullptr) continue;
+
+            const Leaf* leaf = static_cast<const Leaf*>(node);
+            int pos = lowerBound(leaf, key);
+            bool found = pos < leaf->count.load(memory_order_relaxed) &&
+                         leaf->keys[pos].load(memory_order_relaxed) == key;
+            Slot slot = found ? leaf->values[pos].load(memory_order_acquire) : Slot();
+
+            checkVersion(leaf, version, restart);
+            if (restart) continue;
+
+            if (!found) return false;
+            readSlot(slot, out);
+            return true;
+        }
+    }
+
+    bool contains(const K& key) const {
+        V ignored;
+        return lookup(key, ignored);
+    }
+
+    // Inserts or replaces the value for key. Returns true when the key is new.
+    bool insert(const K& key, const V& value) {
+        Slot stored = makeSlot(value);
+        Slot replaced;
+        {
+            EpochReclaimer::Guard guard(reclaimer);
+            if (insertPinned(key, stored, replaced)) {
+                entryCount.fetch_add(1, memory_order_relaxed);
+                return true;
+            }
+        }
+        retireSlot(replaced);
+        return false;
+    }
+
+    long long size() const { return entryCount.load(memory_order_relaxed); }
+
+    // Detaches the current contents; the old nodes are freed once readers
+    // still traversing them are done.
+    void clear() {
+        Node* old = root.exchange(new Leaf(), memory_order_acq_rel);
+        entryCount.store(0, memory_order_relaxed);
+        reclaimer.retire(old, [](void* node) { destroy(static_cast<Node*>(node)); });
+    }
+};
+
+#endif
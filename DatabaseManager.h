@@ -2,27 +2,50 @@
 #define DATABASE_MANAGER_H
 
 #include "BTree.h"
+#include "ConcurrentBTree.h"
+#include "TrigramIndex.h"
 #include "Graph.h"
+#include "AdjacencyCache.h"
+#include "ImportBatch.h"
 #include "Location.h"
 #include "Edge.h"
 #include <string>
 #include <vector>
+#include <cstdint>
+#include <atomic>
 
 using namespace std;
 
 class DatabaseManager {
 private:
-    BTree* locationBTree;
-    BTree* edgeBTree;
+    BTree<int, Location>* locationBTree;
+    BTree<int, Edge>* edgeBTree;
+    ConcurrentBTree<int, Location>* locationIndex;
+    BTree<string, int>* nameIndex;
+    TrigramIndex* trigramIndex;
+    BTree<int64_t, Neighbor>* adjacencyIndex;
+    AdjacencyCache* adjacencyCache;
     Graph* graph;
     
     string dataDirectory;
     string locationFile;
     string edgeFile;
+    string adjacencyFile;
     
     int nextLocationId;
     int nextEdgeId;
     bool dataModified;
+    bool lazyGraph;
+    // Bumped after every change to locations or roads; cached routes are
+    // only valid for the version they were computed against.
+    atomic<uint64_t> graphVersion;
+
+    static string foldName(const string& name);
+    void indexName(const Location& location);
+    static int64_t adjacencyKey(int nodeId, int edgeId);
+    void indexEdge(const Edge& edge);
+    bool adjacencyFileCurrent();
+    void rebuildIndexes(const vector<Location>* addedLocations, const vector<Edge>* addedEdges);
 
 public:
     DatabaseManager(const string& dataDir = "data");
@@ -38,19 +61,38 @@ public:
     int addEdge(int sourceId, int destId, double distance, 
                 const string& roadName, bool bidirectional = true);
     bool addEdge(const Edge& edge);
+    bool importBatch(ImportBatch& batch, string& error);
 
     Location getLocation(int locationId);
     Edge getEdge(int edgeId);
+    const Location* findLocation(int locationId) const;
+    const Edge* findEdge(int edgeId) const;
+    bool lookupLocation(int locationId, Location& out) const;
     bool locationExists(int locationId);
     bool edgeExists(int edgeId);
     vector<Location> getAllLocations();
+    vector<Location> searchLocations(const string& prefix, int limit);
+    vector<Location> fuzzySearchLocations(const string& query, int limit);
     vector<Edge> getAllEdges();
     int getLocationCount();
     int getEdgeCount();
+    const BTree<int, Location>& getLocationTree() const { return *locationBTree; }
+    const BTree<int, Edge>& getEdgeTree() const { return *edgeBTree; }
+
+    void loadNeighbors(int nodeId, vector<Neighbor>& out) const;
+
+    // Lazy mode keeps only locations in the Graph; roads are read from the
+    // adjacency index on demand through the adjacency cache. The index is
+    // saved next to the edges and loaded from there at startup. It is only
+    // built in lazy mode. Set it before initialize().
+    void setLazyGraph(bool lazy) { lazyGraph = lazy; }
+    bool isLazyGraph() const { return lazyGraph; }
+    AdjacencyCache* getAdjacencyCache() { return lazyGraph ? adjacencyCache : nullptr; }
 
     void buildGraph();
     Graph* getGraph() { return graph; }
     bool isModified() const { return dataModified; }
+    uint64_t getGraphVersion() const { return graphVersion.load(); }
     void initializeSampleData();
     void clearAll();
 };
@@ -0,0 +1,151 @@
+#ifndef EPOCH_RECLAIMER_H
+#define EPOCH_RECLAIMER_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+const size_t EPOCH_READER_SLOTS = 64;
+
+// Epoch-based reclamation for structures read without locks. A reader
+// pins the current epoch in a slot for as long as it may hold pointers
+// into the structure. Whoever unlinks an object retires it, which stamps
+// it with the epoch and advances the epoch; it is freed once every pinned
+// slot shows a later epoch, since any reader that could still see the
+// object pinned before it was unlinked.
+//
+// Slots are claimed per pin rather than per thread, starting from one
+// picked by thread ID, so any thread can pin without registering. Each
+// slot has its own cache line. Objects are freed by a later retire() or
+// by the destructor, never by readers. Thread-safe.
+class EpochReclaimer {
+public:
+    typedef void (*Deleter)(void*);
+
+private:
+    static const uint64_t QUIESCENT = 0;
+
+    struct alignas(64) ReaderSlot {
+        atomic<uint64_t> epoch;
+        ReaderSlot() : epoch(QUIESCENT) {}
+    };
+
+    struct Retired {
+        void* object;
+        Deleter deleter;
+        uint64_t epoch;
+    };
+
+    atomic<uint64_t> globalEpoch;
+    ReaderSlot slots[EPOCH_READER_SLOTS];
+    mutex retiredMutex;
+    vector<Retired> retired;
+
+    static size_t homeSlot() {
+        static thread_local size_t home = hash<thread::id>()(this_thread::get_id()) % EPOCH_READER_SLOTS;
+        return home;
+    }
+
+    // The epoch is published and then read again; if it moved in between,
+    // a reclaimer may have scanned past this slot, so the newer epoch is
+    // published instead.
+    size_t enter() {
+        size_t index = homeSlot();
+        while (true) {
+            for (size_t tried = 0; tried < EPOCH_READER_SLOTS; tried++) {
+                uint64_t epoch = globalEpoch.load();
+                uint64_t expected = QUIESCENT;
+                if (slots[index].epoch.compare_exchange_strong(expected, epoch)) {
+                    uint64_t current;
+                    while ((current = globalEpoch.load()) != epoch) {
+                        slots[index].epoch.store(current);
+                        epoch = current;
+                    }
+                    return index;
+                }
+                index = (index + 1) % EPOCH_READER_SLOTS;
+            }
+            this_thread::yield();
+        }
+    }
+
+    void leave(size_t index) {
+        slots[index].epoch.store(QUIESCENT, memory_order_release);
+    }
+
+    uint64_t oldestPinned() const {
+        uint64_t oldest = UINT64_MAX;
+        for (const ReaderSlot& slot : slots) {
+            uint64_t epoch = slot.epoch.load();
+            if (epoch != QUIESCENT && epoch < oldest) {
+                oldest = epoch;
+            }
+        }
+        return oldest;
+    }
+
+public:
+    // Keeps objects reachable when it was taken from being freed until it
+    // goes out of scope.
+    class Guard {
+    private:
+        EpochReclaimer* owner;
+        size_t slot;
+
+    public:
+        explicit Guard(EpochReclaimer& reclaimer) : owner(&reclaimer), slot(reclaimer.enter()) {}
+        ~Guard() { owner->leave(slot); }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    };
+
+    EpochReclaimer() : globalEpoch(1) {}
+
+    ~EpochReclaimer() {
+        for (const Retired& entry : retired) {
+            entry.deleter(entry.object);
+        }
+    }
+
+    EpochReclaimer(const EpochReclaimer&) = delete;
+    EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+    // Hands over an object that is no longer reachable, then frees every
+    // retired object no pinned reader can still see. Deleters run outside
+    // the lock.
+    void retire(void* object, Deleter deleter) {
+        uint64_t epoch = globalEpoch.fetch_add(1);
+        vector<Retired> ready;
+        {
+            lock_guard<mutex> lock(retiredMutex);
+            retired.push_back(Retired{object, deleter, epoch});
+            uint64_t oldest = oldestPinned();
+            size_t kept = 0;
+            for (const Retired& entry : retired) {
+                if (entry.epoch < oldest) {
+                    ready.push_back(entry);
+                } else {
+                    retired[kept++] = entry;
+                }
+            }
+            retired.resize(kept);
+        }
+        for (const Retired& entry : ready) {
+            entry.deleter(entry.object);
+        }
+    }
+
+    size_t pendingCount() {
+        lock_guard<mutex> lock(retiredMutex);
+        return retired.size();
+    }
+};
+
+#endif
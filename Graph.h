@@ -2,9 +2,16 @@
 #define GRAPH_H
 
 #include "Location.h"
+#include "Edge.h"
+#include "Arena.h"
 #include <map>
 #include <vector>
+#include <string>
+#include <sstream>
+#include <charconv>
 #include <utility>
+#include <cstdint>
+#include <memory_resource>
 
 using namespace std;
 
@@ -12,13 +19,36 @@ struct Neighbor {
     int nodeId;
     double distance;
     
+    Neighbor() : nodeId(0), distance(0.0) {}
     Neighbor(int id, double dist) : nodeId(id), distance(dist) {}
+
+    // Record form for the saved adjacency index. The distance is written
+    // at full precision so a reloaded index matches the roads exactly.
+    string serialize() const {
+        ostringstream oss;
+        oss.precision(17);
+        oss << nodeId << "|" << distance;
+        return oss.str();
+    }
+
+    static Neighbor deserialize(int64_t, const string& data) {
+        Neighbor neighbor;
+        const char* last = data.data() + data.size();
+        auto parsed = from_chars(data.data(), last, neighbor.nodeId);
+        if (parsed.ptr != last && *parsed.ptr == '|') {
+            from_chars(parsed.ptr + 1, last, neighbor.distance);
+        }
+        return neighbor;
+    }
 };
 
+// Map nodes and adjacency vectors are allocated from the graph's arena, so
+// clear() before a reload gives all of that memory back in one release.
 class Graph {
 private:
-    map<int, Location> nodes;
-    map<int, vector<Neighbor>> adjacencyList;
+    Arena arena;
+    pmr::map<int, Location> nodes;
+    pmr::map<int, pmr::vector<Neighbor>> adjacencyList;
 
 public:
     Graph();
@@ -26,8 +56,11 @@ public:
 
     void addNode(const Location& location);
     void addEdge(int sourceId, int destId, double distance, bool bidirectional = true);
+    void build(const vector<Location>& locations, const vector<Edge>& edges);
     bool nodeExists(int nodeId) const;
     Location getNode(int nodeId) const;
+    // Borrowed pointer into the graph, nullptr if absent; no copy of the name.
+    const Location* findNode(int nodeId) const;
     vector<Neighbor> getNeighbors(int nodeId) const;
     vector<Location> getAllNodes() const;
     int getNodeCount() const { return nodes.size(); }
@@ -35,6 +68,7 @@ public:
     bool isEmpty() const { return nodes.empty(); }
     void clear();
     void printGraph() const;
+    const Arena& getArena() const { return arena; }
 };
 
 #endif
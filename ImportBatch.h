@@ -0,0 +1,83 @@
+#ifndef IMPORT_BATCH_H
+#define IMPORT_BATCH_H
+
+#include "Location.h"
+#include "Edge.h"
+#include <string>
+#include <vector>
+#include <istream>
+
+using namespace std;
+
+const int MAX_IMPORT_RECORDS = 10000000;
+
+// Records for one bulk import, one per line:
+//   L|id|name|latitude|longitude|type
+//   R|id|sourceId|destId|distance|roadName|bidirectional
+// Blank lines and lines starting with '#' are skipped. An ID of 0 asks the
+// database to assign a free one, above every ID already in use or given in
+// the batch. An explicit ID may appear only once per batch; if the record
+// already exists it is replaced (an upsert). Parsing only stages the
+// records; DatabaseManager::importBatch validates and applies them as a
+// whole.
+struct ImportBatch {
+    vector<Location> locations;
+    vector<Edge> edges;
+    int lineNumber;
+    string error;
+
+    ImportBatch() : lineNumber(0) {}
+
+    bool failed() const { return !error.empty(); }
+
+    static bool isRecordLine(const string& line) {
+        return line.size() > 1 && (line[0] == 'L' || line[0] == 'R') && line[1] == '|';
+    }
+
+    // Returns false on a malformed line; the first error is kept and later
+    // lines are still counted so a streaming reader stays in step.
+    bool addLine(string line) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#' || failed()) {
+            return !failed();
+        }
+
+        if (!isRecordLine(line)) {
+            error = "line " + to_string(lineNumber) + ": unknown record type";
+            return false;
+        }
+
+        size_t idEnd = line.find('|', 2);
+        if (idEnd == string::npos) {
+            error = "line " + to_string(lineNumber) + ": missing fields";
+            return false;
+        }
+
+        try {
+            int id = stoi(line.substr(2, idEnd - 2));
+            string data = line.substr(idEnd + 1);
+            if (line[0] == 'L') {
+                locations.push_back(Location::deserialize(id, data));
+            } else {
+                edges.push_back(Edge::deserialize(id, data));
+            }
+        } catch (...) {
+            error = "line " + to_string(lineNumber) + ": bad number";
+            return false;
+        }
+        return true;
+    }
+
+    bool readFrom(istream& in) {
+        string line;
+        while (getline(in, line)) {
+            addLine(line);
+        }
+        return !failed();
+    }
+};
+
+#endif
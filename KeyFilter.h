@@ -0,0 +1,176 @@
+#ifndef KEY_FILTER_H
+#define KEY_FILTER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+
+using namespace std;
+
+enum class KeyFilterMode {
+    NONE,
+    BLOOM,
+    DENSE_BITMAP
+};
+
+// Approximate membership front for a BTree. mayContain() returning false is
+// a definite miss, so the caller can skip the descent entirely.
+//
+// BLOOM is a blocked Bloom filter: all probes for a key land in one 512-bit
+// block (a single cache line), about 10 bits per key. DENSE_BITMAP keeps one
+// exact bit per integer key for compact ID ranges such as the sequential
+// location and edge IDs; keys that fall far outside the range flip it into
+// "maybe" for those keys instead of growing without bound. The bitmap never
+// grows over the lowest such key afterwards, since covering it would turn
+// its "maybe" into a wrong "no".
+template<typename K>
+class KeyFilter {
+private:
+    static const size_t BLOCK_WORDS = 8;
+    static const size_t BITS_PER_KEY = 10;
+    static const size_t MIN_BLOOM_BLOCKS = 16;
+    static const int BLOOM_PROBES = 6;
+    static const size_t MIN_BITMAP_BITS = 1 << 20;
+    static const size_t BITMAP_SPARSE_FACTOR = 16;
+
+    KeyFilterMode mode;
+    vector<uint64_t> bits;
+    size_t keyCount;
+    size_t bloomCapacity;
+    bool bitmapOverflow;
+    size_t overflowFloor;  // lowest non-negative key left out of the bitmap
+
+    static uint64_t hashKey(const K& key) {
+        uint64_t h;
+        if constexpr (is_integral<K>::value) {
+            h = (uint64_t)key;
+        } else {
+            h = (uint64_t)std::hash<K>()(key);
+        }
+        // splitmix64 finaliser
+        h += 0x9E3779B97F4A7C15ULL;
+        h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+        return h ^ (h >> 31);
+    }
+
+    void bloomAdd(uint64_t h) {
+        size_t blocks = bits.size() / BLOCK_WORDS;
+        uint64_t* block = &bits[(size_t)((h >> 32) % blocks) * BLOCK_WORDS];
+        for (int i = 0; i < BLOOM_PROBES; i++) {
+            unsigned bit = (unsigned)(h >> (i * 9)) & 511u;
+            block[bit >> 6] |= 1ULL << (bit & 63);
+        }
+    }
+
+    bool bloomTest(uint64_t h) const {
+        size_t blocks = bits.size() / BLOCK_WORDS;
+        const uint64_t* block = &bits[(size_t)((h >> 32) % blocks) * BLOCK_WORDS];
+        for (int i = 0; i < BLOOM_PROBES; i++) {
+            unsigned bit = (unsigned)(h >> (i * 9)) & 511u;
+            if ((block[bit >> 6] & (1ULL << (bit & 63))) == 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void rejectFromBitmap(size_t index) {
+        bitmapOverflow = true;
+        if (index < overflowFloor) overflowFloor = index;
+    }
+
+    void resizeBloom(size_t capacity) {
+        bloomCapacity = capacity;
+        size_t blocks = (capacity * BITS_PER_KEY + 511) / 512;
+        if (blocks < MIN_BLOOM_BLOCKS) blocks = MIN_BLOOM_BLOCKS;
+        bits.assign(blocks * BLOCK_WORDS, 0);
+    }
+
+public:
+    KeyFilter() : mode(KeyFilterMode::NONE), keyCount(0), bloomCapacity(0), bitmapOverflow(false),
+                  overflowFloor(SIZE_MAX) {}
+
+    KeyFilterMode getMode() const { return mode; }
+    bool isEnabled() const { return mode != KeyFilterMode::NONE; }
+
+    // Forgets all keys and prepares for about expectedKeys insertions.
+    void reset(KeyFilterMode newMode, size_t expectedKeys = 0) {
+        mode = newMode;
+        keyCount = 0;
+        bitmapOverflow = false;
+        overflowFloor = SIZE_MAX;
+        bits.clear();
+        bloomCapacity = 0;
+
+        if (mode == KeyFilterMode::BLOOM) {
+            resizeBloom(expectedKeys < 1024 ? 1024 : expectedKeys);
+        }
+    }
+
+    // A Bloom filter sized for fewer keys than it now holds needs to be
+    // rebuilt from the tree; the caller checks this after each insert.
+    bool needsRebuild() const {
+        return mode == KeyFilterMode::BLOOM && keyCount > bloomCapacity;
+    }
+
+    void add(const K& key) {
+        keyCount++;
+
+        if (mode == KeyFilterMode::BLOOM) {
+            bloomAdd(hashKey(key));
+        } else if (mode == KeyFilterMode::DENSE_BITMAP) {
+            if constexpr (is_integral<K>::value) {
+                if (key < 0) {
+                    bitmapOverflow = true;
+                    return;
+                }
+                size_t index = (size_t)key;
+                size_t limit = keyCount * BITMAP_SPARSE_FACTOR;
+                if (limit < MIN_BITMAP_BITS) limit = MIN_BITMAP_BITS;
+
+                if (index >= bits.size() * 64) {
+                    if (index >= limit) {
+                        rejectFromBitmap(index);
+                        return;
+                    }
+                    size_t words = bits.size() < 16 ? 16 : bits.size();
+                    while (words * 64 <= index) words *= 2;
+                    if (words > overflowFloor / 64) words = overflowFloor / 64;
+                    if (words * 64 <= index) {
+                        rejectFromBitmap(index);
+                        return;
+                    }
+                    bits.resize(words, 0);
+                }
+                bits[index >> 6] |= 1ULL << (index & 63);
+            } else {
+                bitmapOverflow = true;
+            }
+        }
+    }
+
+    bool mayContain(const K& key) const {
+        if (mode == KeyFilterMode::BLOOM) {
+            return bloomTest(hashKey(key));
+        }
+        if (mode == KeyFilterMode::DENSE_BITMAP) {
+            if constexpr (is_integral<K>::value) {
+                if (key < 0) return bitmapOverflow;
+                size_t index = (size_t)key;
+                if (index >= bits.size() * 64) return bitmapOverflow;
+                return (bits[index >> 6] >> (index & 63)) & 1ULL;
+            } else {
+                return true;
+            }
+        }
+        return true;
+    }
+
+    size_t getKeyCount() const { return keyCount; }
+    size_t getMemoryBytes() const { return bits.size() * sizeof(uint64_t); }
+};
+
+#endif
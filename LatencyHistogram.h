@@ -0,0 +1,108 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+using namespace std;
+
+// Log-linear latency histogram in microseconds, after HdrHistogram: values
+// below 2 * HALF_BUCKETS are counted exactly, larger ones by power of two
+// and then in HALF_BUCKETS linear steps, so a reported percentile is within
+// 1 / HALF_BUCKETS (under 1%) of the recorded value. The size is fixed at
+// construction, recording never allocates, and histograms from several
+// threads combine with merge().
+class LatencyHistogram {
+private:
+    static constexpr int SUB_BUCKET_BITS = 8;
+    static constexpr uint64_t HALF_BUCKETS = 1ULL << (SUB_BUCKET_BITS - 1);
+    static constexpr int MAX_SHIFT = 40;
+
+    vector<uint64_t> counts;
+    uint64_t total;
+    uint64_t maxValue;
+    double sum;
+
+    static int bitLength(uint64_t value) {
+        int bits = 0;
+        while (value != 0) {
+            value >>= 1;
+            bits++;
+        }
+        return bits;
+    }
+
+    static size_t indexOf(uint64_t value) {
+        if (value < 2 * HALF_BUCKETS) {
+            return (size_t)value;
+        }
+        int shift = min(bitLength(value) - SUB_BUCKET_BITS, MAX_SHIFT);
+        uint64_t step = min(value >> shift, 2 * HALF_BUCKETS - 1);
+        return (size_t)(2 * HALF_BUCKETS + (shift - 1) * HALF_BUCKETS + (step - HALF_BUCKETS));
+    }
+
+    // Largest value that falls into the bucket.
+    static uint64_t highestValueAt(size_t index) {
+        if (index < 2 * HALF_BUCKETS) {
+            return index;
+        }
+        size_t offset = index - 2 * HALF_BUCKETS;
+        int shift = (int)(offset / HALF_BUCKETS) + 1;
+        uint64_t step = HALF_BUCKETS + offset % HALF_BUCKETS;
+        return ((step + 1) << shift) - 1;
+    }
+
+public:
+    LatencyHistogram()
+        : counts(2 * HALF_BUCKETS + MAX_SHIFT * HALF_BUCKETS, 0), total(0), maxValue(0), sum(0.0) {}
+
+    void record(uint64_t micros) {
+        counts[indexOf(micros)]++;
+        total++;
+        maxValue = max(maxValue, micros);
+        sum += (double)micros;
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < counts.size(); i++) {
+            counts[i] += other.counts[i];
+        }
+        total += other.total;
+        maxValue = max(maxValue, other.maxValue);
+        sum += other.sum;
+    }
+
+    void clear() {
+        fill(counts.begin(), counts.end(), 0);
+        total = 0;
+        maxValue = 0;
+        sum = 0.0;
+    }
+
+    uint64_t getCount() const { return total; }
+    uint64_t getMax() const { return maxValue; }
+    double getMean() const { return total ? sum / total : 0.0; }
+
+    // Smallest recorded value at or above the given fraction (0..1) of all
+    // values, reported as the top of its bucket.
+    uint64_t percentile(double fraction) const {
+        if (total == 0) {
+            return 0;
+        }
+        uint64_t rank = (uint64_t)(fraction * total);
+        rank = max<uint64_t>(1, min(rank + (fraction * total > rank ? 1 : 0), total));
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); i++) {
+            seen += counts[i];
+            if (seen >= rank) {
+                // The last bucket also holds everything beyond the range.
+                return i + 1 == counts.size() ? maxValue : min(highestValueAt(i), maxValue);
+            }
+        }
+        return maxValue;
+    }
+};
+
+#endif
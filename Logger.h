@@ -0,0 +1,117 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdint>
+
+using namespace std;
+
+// Per-request trace lines are compiled out unless LOG_TRACE_SAMPLE is set
+// to N > 0, which keeps one request in N; all lines of a sampled request
+// are kept together. -DLOG_TRACE_SAMPLE=1 traces every request.
+#ifndef LOG_TRACE_SAMPLE
+    #define LOG_TRACE_SAMPLE 0
+#endif
+
+#if LOG_TRACE_SAMPLE > 0
+    #define LOG_REQUEST(clientId, requestId, message) \
+        do { \
+            if ((unsigned)((clientId) * 31 + (requestId)) % LOG_TRACE_SAMPLE == 0) \
+                Logger::instance().write(LogLevel::TRACE, (message)); \
+        } while (0)
+#else
+    #define LOG_REQUEST(clientId, requestId, message) do { } while (0)
+#endif
+
+enum class LogLevel {
+    TRACE,
+    INFO,
+    WARN,
+    FAILURE
+};
+
+const int LOG_MESSAGE_BYTES = 200;
+const int LOG_BUFFER_RECORDS = 512;
+const int LOG_FLUSH_INTERVAL_MS = 20;
+const int DEFAULT_LOG_RATE_PER_SECOND = 1000;
+const int DEFAULT_LOG_BURST = 2000;
+
+struct LogRecord {
+    int64_t timeMicros;
+    LogLevel level;
+    int length;
+    char text[LOG_MESSAGE_BYTES];
+};
+
+// Single-producer ring owned by one logging thread and drained by the
+// logger thread. The token bucket is touched only by the producer.
+struct LogBuffer {
+    LogRecord records[LOG_BUFFER_RECORDS];
+    atomic<uint64_t> head;
+    atomic<uint64_t> tail;
+    atomic<uint64_t> dropped;
+    atomic<uint64_t> suppressed;
+    atomic<bool> retired;
+    double tokens;
+    int64_t lastRefillMicros;
+
+    LogBuffer() : head(0), tail(0), dropped(0), suppressed(0), retired(false),
+                  tokens(DEFAULT_LOG_BURST), lastRefillMicros(0) {}
+};
+
+// Asynchronous logger. write() copies the message into the calling
+// thread's ring and returns; it never locks or does I/O. A background
+// thread drains all rings every LOG_FLUSH_INTERVAL_MS, orders the records
+// by time, formats the timestamps and writes them to stdout with a single
+// flush. A full ring drops the message instead of blocking, and TRACE and
+// INFO are rate limited per thread; both are counted and reported.
+class Logger {
+private:
+    atomic<LogLevel> level;
+    atomic<int> ratePerSecond;
+    atomic<int> burst;
+
+    mutex registryMutex;
+    vector<LogBuffer*> buffers;
+
+    mutex wakeMutex;
+    condition_variable wake;
+    condition_variable flushed;
+    uint64_t flushRequests;
+    uint64_t flushesDone;
+    bool stopping;
+    thread drainThread;
+
+    LogBuffer* threadBuffer();
+    bool takeToken(LogBuffer* buffer, int64_t nowMicros);
+    void drain();
+    void run();
+
+    Logger();
+
+public:
+    ~Logger();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    static Logger& instance();
+
+    void write(LogLevel messageLevel, const string& message);
+    bool isEnabled(LogLevel messageLevel) const { return messageLevel >= level.load(memory_order_relaxed); }
+
+    // Blocks until everything written before the call has been printed.
+    void flush();
+    void stop();
+
+    void setLevel(LogLevel minimum) { level.store(minimum); }
+    LogLevel getLevel() const { return level.load(); }
+    void setRateLimit(int perSecond, int burstSize);
+};
+
+#endif
@@ -2,6 +2,8 @@
 #define NAVIGATION_H
 
 #include "Graph.h"
+#include "AdjacencyCache.h"
+#include "CancellationToken.h"
 #include <vector>
 #include <string>
 #include <utility>
@@ -9,26 +11,64 @@
 
 using namespace std;
 
+// Search counters behind FIND_PATH explain=1. Builds that define
+// NAVIGATION_PROFILE=0 drop every counter update and clock read from the
+// search, leaving the profile zeroed.
+#ifndef NAVIGATION_PROFILE
+    #define NAVIGATION_PROFILE 1
+#endif
+
+// Settled nodes between checks of a search's cancellation token; a power
+// of two.
+const int CANCEL_CHECK_INTERVAL = 256;
+
+struct SearchProfile {
+    const char* engine;
+    long long edgesScanned;
+    long long edgesRelaxed;
+    long long heapPushes;
+    long long heapPops;
+    size_t maxFrontier;
+    long long setupMicros;
+    long long searchMicros;
+    long long pathMicros;
+    
+    SearchProfile() : engine(""), edgesScanned(0), edgesRelaxed(0), heapPushes(0), heapPops(0),
+                      maxFrontier(0), setupMicros(0), searchMicros(0), pathMicros(0) {}
+};
+
 struct PathResult {
     bool found;
     vector<int> path;
     double totalDistance;
     string errorMessage;
+    int nodesSettled;
+    // The search was abandoned through its cancellation token; says
+    // nothing about whether a path exists.
+    bool aborted;
+    SearchProfile profile;
     
-    PathResult() : found(false), totalDistance(0.0), errorMessage("") {}
+    PathResult() : found(false), totalDistance(0.0), errorMessage(""), nodesSettled(0), aborted(false) {}
 };
 
 class Navigation {
 private:
     Graph* graph;
+    AdjacencyCache* adjacency;
+    vector<Neighbor> scratch;
     
+    const vector<Neighbor>& neighborsOf(int nodeId);
     vector<int> reconstructPath(const map<int, int>& previous, int start, int end);
 
 public:
-    Navigation(Graph* graph);
+    // With an adjacency cache, roads are faulted in per node as the search
+    // reaches it and the graph is only consulted for locations.
+    Navigation(Graph* graph, AdjacencyCache* adjacency = nullptr);
     ~Navigation();
 
-    PathResult dijkstra(int sourceId, int destinationId);
+    PathResult dijkstra(int sourceId, int destinationId,
+                        const CancellationToken& token = CancellationToken());
+    static bool isProfilingEnabled() { return NAVIGATION_PROFILE != 0; }
     vector<string> getDirections(const PathResult& result);
     static double haversineDistance(double lat1, double lon1, double lat2, double lon2);
 };
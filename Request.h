@@ -5,6 +5,11 @@
 #include <sstream>
 #include <map>
 #include <vector>
+#include <chrono>
+#include <memory>
+#include <string_view>
+#include <charconv>
+#include "RequestParams.h"
 
 using namespace std;
 
@@ -18,6 +23,9 @@ enum class RequestType {
     INIT_SAMPLE,
     SAVE_DATA,
     SHUTDOWN,
+    SEARCH_LOCATION,
+    IMPORT,
+    STATS,
     UNKNOWN
 };
 
@@ -25,112 +33,150 @@ enum class ResponseStatus {
     SUCCESS,
     FAILURE,
     NOT_FOUND,
-    INVALID_PARAMS
+    INVALID_PARAMS,
+    TIMEOUT
 };
 
 struct Request {
     int clientId;
     int requestId;
     RequestType type;
-    map<string, string> params;
+    RequestParams params;
+    // Set by the server when the line is read; not part of the wire format.
+    // The deadline is receivedAt plus deadline_ms, or max() without one.
+    chrono::steady_clock::time_point receivedAt;
+    chrono::steady_clock::time_point deadline;
     
-    Request() : clientId(0), requestId(0), type(RequestType::UNKNOWN) {}
+    Request() : clientId(0), requestId(0), type(RequestType::UNKNOWN),
+                deadline(chrono::steady_clock::time_point::max()) {}
     
     Request(int cId, int rId, RequestType t) 
-        : clientId(cId), requestId(rId), type(t) {}
+        : clientId(cId), requestId(rId), type(t), deadline(chrono::steady_clock::time_point::max()) {}
     
     string serialize() const {
         ostringstream oss;
         oss << clientId << "|" << requestId << "|" << static_cast<int>(type) << "|";
         
-        bool first = true;
-        for (const auto& [key, value] : params) {
-            if (!first) oss << ";";
-            oss << key << "=" << value;
-            first = false;
+        for (int i = 0; i < params.size(); i++) {
+            const RequestParam& param = params.at(i);
+            if (i > 0) oss << ";";
+            oss << param.keyName() << "=" << param.value;
         }
         
         return oss.str();
     }
     
+    // Splits the line in place; the only copies made are the parameter
+    // values themselves. Malformed numbers leave the field at its default.
     static Request deserialize(const string& data) {
         Request req;
-        istringstream iss(data);
-        string token;
-        
-        if (getline(iss, token, '|')) {
-            req.clientId = stoi(token);
+        string_view rest(data);
+        string_view fields[4];
+        int fieldCount = 0;
+        while (fieldCount < 4) {
+            size_t bar = rest.find('|');
+            fields[fieldCount++] = rest.substr(0, bar);
+            if (bar == string_view::npos) break;
+            rest.remove_prefix(bar + 1);
         }
         
-        if (getline(iss, token, '|')) {
-            req.requestId = stoi(token);
-        }
-        
-        if (getline(iss, token, '|')) {
-            req.type = static_cast<RequestType>(stoi(token));
-        }
+        int type = static_cast<int>(RequestType::UNKNOWN);
+        if (fieldCount > 0) parseField(fields[0], req.clientId);
+        if (fieldCount > 1) parseField(fields[1], req.requestId);
+        if (fieldCount > 2) parseField(fields[2], type);
+        req.type = static_cast<RequestType>(type);
         
-        if (getline(iss, token, '|')) {
-            istringstream paramStream(token);
-            string param;
-            while (getline(paramStream, param, ';')) {
+        if (fieldCount > 3) {
+            string_view list = fields[3];
+            while (!list.empty()) {
+                size_t semicolon = list.find(';');
+                string_view param = list.substr(0, semicolon);
                 size_t eqPos = param.find('=');
-                if (eqPos != string::npos) {
-                    string key = param.substr(0, eqPos);
-                    string value = param.substr(eqPos + 1);
-                    req.params[key] = value;
+                if (eqPos != string_view::npos) {
+                    req.params.set(param.substr(0, eqPos), param.substr(eqPos + 1));
                 }
+                if (semicolon == string_view::npos) break;
+                list.remove_prefix(semicolon + 1);
             }
         }
         
         return req;
     }
     
-    string getParam(const string& key) const {
-        auto it = params.find(key);
-        return (it != params.end()) ? it->second : "";
+    // The ParamKey forms compare interned IDs and are what the server
+    // uses; the string_view forms resolve the name first.
+    string getParam(ParamKey key) const { return valueOf(params.find(key)); }
+    string getParam(string_view key) const { return valueOf(params.find(key)); }
+    
+    int getParamInt(ParamKey key, int defaultValue = 0) const {
+        return intOf(params.find(key), defaultValue);
     }
     
-    int getParamInt(const string& key, int defaultValue = 0) const {
-        string val = getParam(key);
-        if (val.empty()) return defaultValue;
-        try {
-            return stoi(val);
-        } catch (...) {
-            return defaultValue;
-        }
+    int getParamInt(string_view key, int defaultValue = 0) const {
+        return intOf(params.find(key), defaultValue);
     }
     
-    double getParamDouble(const string& key, double defaultValue = 0.0) const {
-        string val = getParam(key);
-        if (val.empty()) return defaultValue;
-        try {
-            return stod(val);
-        } catch (...) {
-            return defaultValue;
-        }
+    double getParamDouble(ParamKey key, double defaultValue = 0.0) const {
+        return numberOf(params.find(key), defaultValue);
+    }
+    
+    double getParamDouble(string_view key, double defaultValue = 0.0) const {
+        return numberOf(params.find(key), defaultValue);
+    }
+    
+    bool getParamBool(ParamKey key, bool defaultValue = false) const {
+        return boolOf(params.find(key), defaultValue);
+    }
+    
+    bool getParamBool(string_view key, bool defaultValue = false) const {
+        return boolOf(params.find(key), defaultValue);
+    }
+    
+    void setParam(string_view key, const string& value) {
+        params.set(key, value);
+    }
+    
+    void setParam(string_view key, const char* value) {
+        params.set(key, value);
+    }
+    
+    void setParam(string_view key, int value) {
+        params.set(key, to_string(value));
     }
     
-    bool getParamBool(const string& key, bool defaultValue = false) const {
-        string val = getParam(key);
-        if (val.empty()) return defaultValue;
-        return (val == "1" || val == "true" || val == "yes");
+    void setParam(string_view key, double value) {
+        params.set(key, to_string(value));
     }
     
-    void setParam(const string& key, const string& value) {
-        params[key] = value;
+    void setParam(string_view key, bool value) {
+        params.set(key, value ? "1" : "0");
     }
     
-    void setParam(const string& key, int value) {
-        params[key] = to_string(value);
+private:
+    static string valueOf(const RequestParam* param) {
+        return param != nullptr ? param->value : "";
     }
     
-    void setParam(const string& key, double value) {
-        params[key] = to_string(value);
+    static int intOf(const RequestParam* param, int defaultValue) {
+        return (param != nullptr && param->hasInt) ? param->intValue : defaultValue;
     }
     
-    void setParam(const string& key, bool value) {
-        params[key] = value ? "1" : "0";
+    static double numberOf(const RequestParam* param, double defaultValue) {
+        return (param != nullptr && param->hasNumber) ? param->numberValue : defaultValue;
+    }
+    
+    static bool boolOf(const RequestParam* param, bool defaultValue) {
+        if (param == nullptr || param->value.empty()) return defaultValue;
+        return (param->value == "1" || param->value == "true" || param->value == "yes");
+    }
+    
+    static void parseField(string_view text, int& out) {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+        int value;
+        auto parsed = from_chars(text.data(), text.data() + text.size(), value);
+        if (parsed.ec == errc() && parsed.ptr != text.data()) {
+            out = value;
+        }
     }
 };
 
@@ -140,6 +186,9 @@ struct Response {
     ResponseStatus status;
     string message;
     string data;
+    // Set instead of data when the payload is shared with a cache entry, so
+    // answering from it copies nothing.
+    shared_ptr<const string> sharedData;
     
     Response() : clientId(0), requestId(0), status(ResponseStatus::SUCCESS) {}
     
@@ -151,7 +200,7 @@ struct Response {
         oss << clientId << "|" << requestId << "|" << static_cast<int>(status) << "|";
         
         string escapedMsg = message;
-        string escapedData = data;
+        string escapedData = getData();
         size_t pos;
         while ((pos = escapedMsg.find('|')) != string::npos) {
             escapedMsg.replace(pos, 1, "\\p");
@@ -164,6 +213,10 @@ struct Response {
         return oss.str();
     }
     
+    const string& getData() const {
+        return sharedData ? *sharedData : data;
+    }
+    
     static Response deserialize(const string& str) {
         Response resp;
         istringstream iss(str);
@@ -195,6 +248,10 @@ struct Response {
     static Response error(int cId, int rId, const string& msg) {
         return Response(cId, rId, ResponseStatus::FAILURE, msg);
     }
+    
+    static Response timeout(int cId, int rId, const string& msg) {
+        return Response(cId, rId, ResponseStatus::TIMEOUT, msg);
+    }
 };
 
 inline string requestTypeToString(RequestType type) {
@@ -208,8 +265,48 @@ inline string requestTypeToString(RequestType type) {
         case RequestType::INIT_SAMPLE: return "INIT_SAMPLE";
         case RequestType::SAVE_DATA: return "SAVE_DATA";
         case RequestType::SHUTDOWN: return "SHUTDOWN";
+        case RequestType::SEARCH_LOCATION: return "SEARCH_LOCATION";
+        case RequestType::IMPORT: return "IMPORT";
+        case RequestType::STATS: return "STATS";
         default: return "UNKNOWN";
     }
 }
 
+// Scheduling classes, highest priority first. READ is the cheap,
+// latency-sensitive traffic (routes and single lookups), WRITE the small
+// updates that need the database exclusively, and BULK whatever may hold a
+// worker for a long time: table dumps, imports, sample loading, saving.
+enum class RequestClass {
+    READ,
+    WRITE,
+    BULK
+};
+
+const int REQUEST_CLASS_COUNT = 3;
+
+inline RequestClass requestClassOf(RequestType type) {
+    switch (type) {
+        case RequestType::ADD_LOCATION:
+        case RequestType::ADD_ROAD:
+        case RequestType::SHUTDOWN:
+            return RequestClass::WRITE;
+        case RequestType::GET_LOCATIONS:
+        case RequestType::GET_ROADS:
+        case RequestType::INIT_SAMPLE:
+        case RequestType::SAVE_DATA:
+        case RequestType::IMPORT:
+            return RequestClass::BULK;
+        default:
+            return RequestClass::READ;
+    }
+}
+
+inline string requestClassToString(RequestClass requestClass) {
+    switch (requestClass) {
+        case RequestClass::READ: return "read";
+        case RequestClass::WRITE: return "write";
+        default: return "bulk";
+    }
+}
+
 #endif
@@ -0,0 +1,166 @@
+#ifndef REQUEST_PARAMS_H
+#define REQUEST_PARAMS_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <charconv>
+#include <cstdint>
+
+using namespace std;
+
+// Parameter names the protocol uses, interned as small IDs so a request
+// stores and compares keys without strings. A name not listed here is
+// still accepted and kept as text under OTHER.
+enum class ParamKey : uint8_t {
+    ID,
+    NAME,
+    LATITUDE,
+    LONGITUDE,
+    TYPE,
+    SOURCE_ID,
+    DEST_ID,
+    DISTANCE,
+    ROAD_NAME,
+    BIDIRECTIONAL,
+    PREFIX,
+    FUZZY,
+    LIMIT,
+    AFTER_ID,
+    STREAM,
+    EXPLAIN,
+    RECORDS,
+    DEADLINE_MS,
+    OTHER
+};
+
+constexpr int PARAM_KEY_COUNT = static_cast<int>(ParamKey::OTHER);
+
+constexpr string_view PARAM_KEY_NAMES[PARAM_KEY_COUNT] = {
+    "id", "name", "latitude", "longitude", "type", "sourceId", "destId",
+    "distance", "roadName", "bidirectional", "prefix", "fuzzy", "limit",
+    "after_id", "stream", "explain", "records", "deadline_ms"
+};
+
+constexpr ParamKey paramKeyFromName(string_view name) {
+    for (int k = 0; k < PARAM_KEY_COUNT; k++) {
+        if (PARAM_KEY_NAMES[k] == name) {
+            return static_cast<ParamKey>(k);
+        }
+    }
+    return ParamKey::OTHER;
+}
+
+static_assert(paramKeyFromName("deadline_ms") == ParamKey::DEADLINE_MS, "PARAM_KEY_NAMES out of step with ParamKey");
+
+// One key=value pair. Numeric forms are parsed once, when the value is
+// set, so reading a parameter repeatedly costs nothing.
+struct RequestParam {
+    ParamKey key = ParamKey::OTHER;
+    bool hasInt = false;
+    bool hasNumber = false;
+    int intValue = 0;
+    double numberValue = 0.0;
+    string name;  // only for OTHER
+    string value;
+
+    string_view keyName() const {
+        return key == ParamKey::OTHER ? string_view(name) : PARAM_KEY_NAMES[static_cast<int>(key)];
+    }
+};
+
+const int INLINE_REQUEST_PARAMS = 8;
+
+// Parameters of a request in the order they were set. The first
+// INLINE_REQUEST_PARAMS live inside the object, which covers every request
+// type the protocol has; more spill into a vector. Short values fit the
+// string's own buffer, so a typical request is decoded without touching
+// the heap.
+class RequestParams {
+private:
+    RequestParam inlineParams[INLINE_REQUEST_PARAMS];
+    vector<RequestParam> overflow;
+    int count = 0;
+
+    RequestParam& at(int index) {
+        return index < INLINE_REQUEST_PARAMS ? inlineParams[index] : overflow[index - INLINE_REQUEST_PARAMS];
+    }
+
+    // stoi/stod conventions: leading whitespace and a '+' are allowed and
+    // trailing text is ignored.
+    static const char* numberStart(string_view text) {
+        const char* first = text.data();
+        const char* last = first + text.size();
+        while (first < last && (*first == ' ' || *first == '\t')) first++;
+        if (first + 1 < last && *first == '+' && *(first + 1) != '-') first++;
+        return first;
+    }
+
+    static void parseNumbers(RequestParam& param) {
+        const char* last = param.value.data() + param.value.size();
+        const char* first = numberStart(param.value);
+        auto asInt = from_chars(first, last, param.intValue);
+        param.hasInt = asInt.ec == errc() && asInt.ptr != first;
+        auto asNumber = from_chars(first, last, param.numberValue);
+        param.hasNumber = asNumber.ec == errc() && asNumber.ptr != first;
+    }
+
+public:
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    const RequestParam& at(int index) const {
+        return index < INLINE_REQUEST_PARAMS ? inlineParams[index] : overflow[index - INLINE_REQUEST_PARAMS];
+    }
+
+    // Compares IDs only; this is what the server's accessors use.
+    const RequestParam* find(ParamKey key) const {
+        for (int i = 0; i < count; i++) {
+            if (at(i).key == key) {
+                return &at(i);
+            }
+        }
+        return nullptr;
+    }
+
+    // By name, for names only known at run time: a protocol name is
+    // resolved to its ID first, anything else is compared as text.
+    const RequestParam* find(string_view name) const {
+        ParamKey key = paramKeyFromName(name);
+        if (key != ParamKey::OTHER) {
+            return find(key);
+        }
+        for (int i = 0; i < count; i++) {
+            const RequestParam& param = at(i);
+            if (param.key == ParamKey::OTHER && param.name == name) {
+                return &param;
+            }
+        }
+        return nullptr;
+    }
+
+    // Replaces the value if the name is already set.
+    void set(string_view name, string_view value) {
+        RequestParam* param = const_cast<RequestParam*>(find(name));
+        if (param == nullptr) {
+            if (count >= INLINE_REQUEST_PARAMS) {
+                overflow.emplace_back();
+            }
+            param = &at(count++);
+            param->key = paramKeyFromName(name);
+            param->name.clear();
+            if (param->key == ParamKey::OTHER) {
+                param->name.assign(name.data(), name.size());
+            }
+        }
+        param->value.assign(value.data(), value.size());
+        parseNumbers(*param);
+    }
+
+    void clear() {
+        count = 0;
+        overflow.clear();
+    }
+};
+
+#endif
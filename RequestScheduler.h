@@ -0,0 +1,211 @@
+#ifndef REQUEST_SCHEDULER_H
+#define REQUEST_SCHEDULER_H
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+struct SchedulerClassConfig {
+    int maxRunning;               // workers the class may occupy at once
+    size_t minDepth;              // always admitted up to this many queued
+    size_t maxDepth;              // nor grows above this
+    int64_t targetWaitMicros;     // queue wait the limit is steered towards
+    int64_t promoteAfterMicros;   // an older head is served ahead of higher classes
+};
+
+// Estimated queueing delay, as a multiple of the class's target wait, past
+// which a new request is refused even though the queue has room.
+const int64_t ADMISSION_WAIT_FACTOR = 4;
+
+// Work queue split into priority classes, class 0 first. Each class has
+// its own bounded queue and a cap on how many workers it may occupy, so a
+// flood of expensive requests can neither fill the queue for everyone nor
+// take every worker. The head of a lower class that has waited longer
+// than promoteAfterMicros is served first, so nothing starves.
+//
+// Admission is per class. A request is refused when its class queue is at
+// its current limit, or when it is past minDepth and the queued work,
+// priced at the class's average service time, would already keep it
+// waiting far past the target.
+// The limit adapts to the wait actually observed: it is cut by a quarter
+// (at most once per target period) when requests waited longer than the
+// target, and grows by one when they got through in under half of it.
+// Thread-safe.
+template<typename T, int CLASSES>
+class RequestScheduler {
+private:
+    typedef chrono::steady_clock Clock;
+
+    struct Entry {
+        T item;
+        Clock::time_point enqueuedAt;
+    };
+
+    struct ClassQueue {
+        SchedulerClassConfig config;
+        deque<Entry> items;
+        size_t limit;
+        int running;
+        double avgServiceMicros;
+        Clock::time_point lastShrink;
+    };
+
+    ClassQueue classes[CLASSES];
+    mutable mutex mtx;
+    condition_variable ready;
+    bool closed;
+
+    static int64_t micros(Clock::duration duration) {
+        return chrono::duration_cast<chrono::microseconds>(duration).count();
+    }
+
+    bool eligible(const ClassQueue& queue) const {
+        return !queue.items.empty() && queue.running < queue.config.maxRunning;
+    }
+
+    // Caller holds mtx. -1 if no class may run now.
+    int pickClass(Clock::time_point now) const {
+        for (int c = CLASSES - 1; c > 0; c--) {
+            const ClassQueue& queue = classes[c];
+            if (eligible(queue) &&
+                micros(now - queue.items.front().enqueuedAt) > queue.config.promoteAfterMicros) {
+                return c;
+            }
+        }
+        for (int c = 0; c < CLASSES; c++) {
+            if (eligible(classes[c])) {
+                return c;
+            }
+        }
+        return -1;
+    }
+
+    // Caller holds mtx.
+    size_t totalQueued() const {
+        size_t total = 0;
+        for (const ClassQueue& queue : classes) {
+            total += queue.items.size();
+        }
+        return total;
+    }
+
+    // Caller holds mtx.
+    static void adaptLimit(ClassQueue& queue, int64_t waitMicros, Clock::time_point now) {
+        const SchedulerClassConfig& config = queue.config;
+        if (waitMicros > config.targetWaitMicros) {
+            if (micros(now - queue.lastShrink) > config.targetWaitMicros) {
+                queue.limit = max(config.minDepth, queue.limit * 3 / 4);
+                queue.lastShrink = now;
+            }
+        } else if (waitMicros < config.targetWaitMicros / 2 && queue.limit < config.maxDepth) {
+            queue.limit++;
+        }
+    }
+
+public:
+    explicit RequestScheduler(const SchedulerClassConfig (&configs)[CLASSES]) : closed(false) {
+        for (int c = 0; c < CLASSES; c++) {
+            classes[c].config = configs[c];
+            classes[c].limit = configs[c].maxDepth;
+            classes[c].running = 0;
+            classes[c].avgServiceMicros = 0.0;
+        }
+    }
+
+    ~RequestScheduler() {
+        close();
+    }
+
+    // False if the class is over its admission limits or the scheduler is
+    // closed; the caller answers the request as rejected.
+    bool tryEnqueue(const T& item, int requestClass) {
+        lock_guard<mutex> lock(mtx);
+        ClassQueue& queue = classes[requestClass];
+        if (closed || queue.items.size() >= queue.limit) {
+            return false;
+        }
+        double expectedWait = queue.items.size() * queue.avgServiceMicros / queue.config.maxRunning;
+        if (queue.items.size() >= queue.config.minDepth &&
+            expectedWait > (double)queue.config.targetWaitMicros * ADMISSION_WAIT_FACTOR) {
+            return false;
+        }
+        queue.items.push_back(Entry{item, Clock::now()});
+        ready.notify_one();
+        return true;
+    }
+
+    // Blocks until some class may run. The caller owns a slot of
+    // requestClass until it calls finish(). False once closed and drained.
+    bool dequeue(T& item, int& requestClass) {
+        unique_lock<mutex> lock(mtx);
+        int picked;
+        ready.wait(lock, [&] {
+            picked = pickClass(Clock::now());
+            return picked >= 0 || (closed && totalQueued() == 0);
+        });
+        if (picked < 0) {
+            return false;
+        }
+
+        ClassQueue& queue = classes[picked];
+        auto now = Clock::now();
+        adaptLimit(queue, micros(now - queue.items.front().enqueuedAt), now);
+        item = queue.items.front().item;
+        queue.items.pop_front();
+        queue.running++;
+        requestClass = picked;
+        return true;
+    }
+
+    // Releases the slot taken by dequeue(). serviceMicros feeds the cost
+    // estimate used for admission; negative when the work was handed off
+    // and its cost says nothing about the class.
+    void finish(int requestClass, int64_t serviceMicros) {
+        {
+            lock_guard<mutex> lock(mtx);
+            ClassQueue& queue = classes[requestClass];
+            queue.running--;
+            if (serviceMicros >= 0) {
+                queue.avgServiceMicros = queue.avgServiceMicros == 0.0
+                    ? (double)serviceMicros
+                    : queue.avgServiceMicros * 0.9 + serviceMicros * 0.1;
+            }
+        }
+        ready.notify_all();
+    }
+
+    void close() {
+        {
+            lock_guard<mutex> lock(mtx);
+            closed = true;
+        }
+        ready.notify_all();
+    }
+
+    size_t size() const {
+        lock_guard<mutex> lock(mtx);
+        return totalQueued();
+    }
+
+    size_t size(int requestClass) const {
+        lock_guard<mutex> lock(mtx);
+        return classes[requestClass].items.size();
+    }
+
+    size_t limit(int requestClass) const {
+        lock_guard<mutex> lock(mtx);
+        return classes[requestClass].limit;
+    }
+
+    int running(int requestClass) const {
+        lock_guard<mutex> lock(mtx);
+        return classes[requestClass].running;
+    }
+};
+
+#endif
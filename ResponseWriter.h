@@ -0,0 +1,78 @@
+#ifndef RESPONSE_WRITER_H
+#define RESPONSE_WRITER_H
+
+#include "Request.h"
+#include <string>
+#include <charconv>
+#include <cstring>
+
+using namespace std;
+
+// Lays out a Response as one wire line without ostringstream or a
+// temporary string. The IDs, status and escaped message go into a header
+// buffer formatted with to_chars; the data is sent straight from the
+// Response unless it contains '|', in which case its escaped copy is built
+// in a second buffer. Both buffers keep their capacity, so a writer reused
+// for one connection stops allocating once it has seen its largest
+// response. The result is up to three slices for a scatter-gather send.
+class ResponseWriter {
+public:
+    struct Slice {
+        const char* data;
+        size_t size;
+    };
+
+    static const int MAX_SLICES = 3;
+
+private:
+    string header;
+    string escaped;
+
+    static void appendEscaped(string& out, const string& text) {
+        size_t start = 0;
+        size_t bar;
+        while ((bar = text.find('|', start)) != string::npos) {
+            out.append(text, start, bar - start);
+            out += "\\p";
+            start = bar + 1;
+        }
+        out.append(text, start, string::npos);
+    }
+
+public:
+    static void appendInt(string& out, long long value) {
+        char digits[24];
+        auto converted = to_chars(digits, digits + sizeof(digits), value);
+        out.append(digits, converted.ptr - digits);
+    }
+
+    // Fills slices with the response line, newline included, and returns
+    // how many were used. They stay valid until the next format() call or
+    // until the response changes.
+    int format(const Response& response, Slice slices[MAX_SLICES]) {
+        header.clear();
+        appendInt(header, response.clientId);
+        header += '|';
+        appendInt(header, response.requestId);
+        header += '|';
+        appendInt(header, static_cast<int>(response.status));
+        header += '|';
+        appendEscaped(header, response.message);
+        header += '|';
+
+        const string& data = response.getData();
+        int count = 0;
+        slices[count++] = { header.data(), header.size() };
+        if (data.find('|') == string::npos) {
+            slices[count++] = { data.data(), data.size() };
+        } else {
+            escaped.clear();
+            appendEscaped(escaped, data);
+            slices[count++] = { escaped.data(), escaped.size() };
+        }
+        slices[count++] = { "\n", 1 };
+        return count;
+    }
+};
+
+#endif
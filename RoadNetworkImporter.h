@@ -0,0 +1,59 @@
+#ifndef ROAD_NETWORK_IMPORTER_H
+#define ROAD_NETWORK_IMPORTER_H
+
+#include "ImportBatch.h"
+#include <string>
+#include <cstddef>
+
+using namespace std;
+
+// Read-only view of a whole file. Uses mmap / a Windows file mapping so the
+// parsers read the page cache directly; falls back to reading the file into
+// memory when mapping is not possible (e.g. an empty file).
+class MappedFile {
+private:
+    const char* data;
+    size_t length;
+    string fallback;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#endif
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const string& path);
+    void close();
+
+    const char* begin() const { return data; }
+    const char* end() const { return data + length; }
+    size_t size() const { return length; }
+};
+
+// Loaders for standard road-network formats. Each fills an ImportBatch for
+// DatabaseManager::importBatch, so the data goes through the same
+// validate-then-bulk-apply path as IMPORT.
+//
+// DIMACS (9th challenge): .co lines "v id lon lat" with coordinates in
+// millionths of a degree, .gr lines "a from to weight" for directed arcs.
+// weightScale converts a weight to kilometres (0.001 for metre weights).
+//
+// CSV: nodes "id,name,latitude,longitude[,type]" and edges
+// "sourceId,destId,distance[,roadName[,bidirectional]]". A first line that
+// does not start with a number is treated as a header.
+class RoadNetworkImporter {
+public:
+    static const double DEFAULT_DIMACS_WEIGHT_SCALE;
+
+    static bool loadDimacs(const string& grPath, const string& coPath, ImportBatch& batch,
+                           string& error, double weightScale = DEFAULT_DIMACS_WEIGHT_SCALE);
+    static bool loadCsv(const string& nodesPath, const string& edgesPath, ImportBatch& batch,
+                        string& error);
+};
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef ROUTE_CACHE_H
+#define ROUTE_CACHE_H
+
+#include "Navigation.h"
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+const size_t DEFAULT_ROUTE_CACHE_BYTES = 64 * 1024 * 1024;
+const int ROUTE_CACHE_SHARDS = 16;
+
+// profile separates engines or cost models that can give different routes
+// for the same pair; the server currently routes with one (0).
+struct RouteKey {
+    int sourceId;
+    int destinationId;
+    int profile;
+
+    RouteKey(int source = 0, int destination = 0, int prof = 0)
+        : sourceId(source), destinationId(destination), profile(prof) {}
+
+    bool operator==(const RouteKey& other) const {
+        return sourceId == other.sourceId && destinationId == other.destinationId &&
+               profile == other.profile;
+    }
+};
+
+struct RouteKeyHash {
+    size_t operator()(const RouteKey& key) const {
+        uint64_t h = ((uint64_t)(uint32_t)key.sourceId << 32) | (uint32_t)key.destinationId;
+        h ^= (uint64_t)(uint32_t)key.profile * 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        return (size_t)h;
+    }
+};
+
+// A finished search and, when it found a path, the FIND_PATH data already
+// formatted for the wire. Immutable once cached and shared by every answer.
+struct CachedRoute {
+    PathResult result;
+    string payload;
+};
+
+// Sharded LRU cache of finished searches, including "no path" answers.
+// Every lookup and insert carries the graph version it was made against;
+// a shard that sees a newer version drops everything it holds, and results
+// computed against an older one are not stored. Each shard keeps its own
+// share of the byte budget. Thread-safe.
+class RouteCache {
+private:
+    struct Entry {
+        shared_ptr<const CachedRoute> route;
+        size_t bytes;
+        list<RouteKey>::iterator position;
+    };
+
+    struct Shard {
+        mutex lock;
+        list<RouteKey> recency;
+        unordered_map<RouteKey, Entry, RouteKeyHash> entries;
+        uint64_t version = 0;
+        size_t bytes = 0;
+        long long hits = 0;
+        long long misses = 0;
+    };
+
+    Shard shards[ROUTE_CACHE_SHARDS];
+    size_t shardBudget;
+
+    Shard& shardFor(const RouteKey& key) {
+        return shards[RouteKeyHash()(key) % ROUTE_CACHE_SHARDS];
+    }
+    // Caller holds the shard lock.
+    static void advanceVersion(Shard& shard, uint64_t version);
+    static size_t entryBytes(const CachedRoute& route);
+
+public:
+    RouteCache(size_t maxBytes = DEFAULT_ROUTE_CACHE_BYTES);
+
+    bool lookup(const RouteKey& key, uint64_t graphVersion, shared_ptr<const CachedRoute>& out);
+    void insert(const RouteKey& key, uint64_t graphVersion, const shared_ptr<const CachedRoute>& route);
+    void clear();
+
+    size_t getSize();
+    size_t getBytes();
+    long long getHits();
+    long long getMisses();
+};
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef SERVER_STATS_H
+#define SERVER_STATS_H
+
+#include "Request.h"
+#include "LatencyHistogram.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+using namespace std;
+
+enum class RequestPhase {
+    QUEUE_WAIT,
+    LOCK_WAIT,
+    EXECUTION,
+    SERIALIZATION
+};
+
+const int REQUEST_PHASE_COUNT = 4;
+const int REQUEST_TYPE_COUNT = static_cast<int>(RequestType::UNKNOWN) + 1;
+
+// Microseconds spent by one request in each phase; a negative value means
+// the phase did not apply (GET_LOCATION takes no lock). An IMPORT's queue
+// wait starts once its last record line is in. SERIALIZATION covers
+// building and writing the response line.
+struct RequestTimings {
+    int64_t phaseMicros[REQUEST_PHASE_COUNT];
+    int nodesSettled;
+
+    RequestTimings() : nodesSettled(-1) {
+        for (int i = 0; i < REQUEST_PHASE_COUNT; i++) {
+            phaseMicros[i] = -1;
+        }
+    }
+
+    void set(RequestPhase phase, chrono::steady_clock::duration elapsed) {
+        phaseMicros[static_cast<int>(phase)] =
+            chrono::duration_cast<chrono::microseconds>(elapsed).count();
+    }
+};
+
+// Counters and histograms for one thread, or merged from all of them.
+// Histograms are allocated on first use, so threads that only ever see a
+// few request types stay small.
+struct RequestStats {
+    uint64_t requests[REQUEST_TYPE_COUNT];
+    uint64_t failures[REQUEST_TYPE_COUNT];
+    uint64_t rejected[REQUEST_TYPE_COUNT];
+    uint64_t timedOut[REQUEST_TYPE_COUNT];   // also counted as failures
+    uint64_t cancelled[REQUEST_TYPE_COUNT];  // dropped, the client had gone
+    unique_ptr<LatencyHistogram> phases[REQUEST_TYPE_COUNT][REQUEST_PHASE_COUNT];
+    LatencyHistogram nodesSettled;
+
+    RequestStats();
+
+    void record(RequestType type, const RequestTimings& timings, bool succeeded);
+    void merge(const RequestStats& other);
+    const LatencyHistogram* getPhase(int type, RequestPhase phase) const {
+        return phases[type][static_cast<int>(phase)].get();
+    }
+};
+
+struct StatsShard {
+    mutex lock;
+    RequestStats stats;
+};
+
+// Values owned by the server that are sampled when a snapshot is taken.
+struct ServerGauges {
+    size_t queueDepth;
+    size_t queueCapacity;
+    // Per scheduling class: queued, current queue limit, workers busy.
+    size_t classDepth[REQUEST_CLASS_COUNT];
+    size_t classLimit[REQUEST_CLASS_COUNT];
+    int classRunning[REQUEST_CLASS_COUNT];
+    long long routeCacheHits;
+    long long routeCacheMisses;
+    size_t routeCacheEntries;
+    size_t routeCacheBytes;
+    long long routeCoalesced;
+    long long routeCoalesceRefused;
+};
+
+// Process-wide request instrumentation. Each thread records into its own
+// RequestStats behind a mutex only a snapshot ever contends for, so
+// recording costs a few clock reads and an uncontended lock per request.
+// Stats of exited threads are folded into a retired total.
+class ServerStats {
+private:
+    mutex registryMutex;
+    vector<StatsShard*> shards;
+    RequestStats retired;
+
+    atomic<int> activeConnections;
+    atomic<uint64_t> totalConnections;
+    chrono::steady_clock::time_point startedAt;
+
+    StatsShard* threadShard();
+
+    ServerStats();
+
+public:
+    ~ServerStats();
+
+    ServerStats(const ServerStats&) = delete;
+    ServerStats& operator=(const ServerStats&) = delete;
+
+    static ServerStats& instance();
+
+    void recordRequest(RequestType type, const RequestTimings& timings, bool succeeded);
+    void recordRejected(RequestType type);
+    void recordTimedOut(RequestType type);
+    void recordCancelled(RequestType type);
+    void connectionOpened();
+    void connectionClosed();
+
+    // Called from the thread-exit hook; merges and frees the shard.
+    void retireShard(StatsShard* shard);
+
+    void snapshot(RequestStats& out);
+
+    // STATS response data: k=v pairs, latencies as p50/p99/p99.9/max in us.
+    string formatSummary(const ServerGauges& gauges);
+    // Prometheus text exposition format.
+    string formatPrometheus(const ServerGauges& gauges);
+    // Writes formatPrometheus to path via a temporary file and a rename, so
+    // a scraper never reads a partial file.
+    bool writePrometheusFile(const string& path, const ServerGauges& gauges);
+};
+
+#endif
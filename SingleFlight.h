@@ -0,0 +1,90 @@
+#ifndef SINGLE_FLIGHT_H
+#define SINGLE_FLIGHT_H
+
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+using namespace std;
+
+const size_t DEFAULT_MAX_FLIGHT_WAITERS = 64;
+
+// Coalesces identical work that is already in progress. The first caller
+// to lead() a key computes it; callers that join() while it runs are
+// parked on the flight instead of repeating the work, and finish() hands
+// them back to the leader to be answered. A flight only takes joiners
+// made against the same version of the underlying data, and holds at most
+// maxWaiters of them; beyond that join() refuses and the caller does the
+// work itself. Sharded by key, thread-safe.
+template<typename Key, typename Waiter, typename Hash = hash<Key>, size_t SHARDS = 16>
+class SingleFlight {
+private:
+    struct Flight {
+        uint64_t version;
+        vector<Waiter> waiters;
+    };
+
+    struct Shard {
+        mutex lock;
+        unordered_map<Key, Flight, Hash> flights;
+    };
+
+    Shard shards[SHARDS];
+    size_t maxWaiters;
+    atomic<long long> joined;
+    atomic<long long> refused;
+
+    Shard& shardFor(const Key& key) {
+        return shards[Hash()(key) % SHARDS];
+    }
+
+public:
+    explicit SingleFlight(size_t maxWaitersPerFlight = DEFAULT_MAX_FLIGHT_WAITERS)
+        : maxWaiters(maxWaitersPerFlight), joined(0), refused(0) {}
+
+    // Starts a flight; false if one for the key is already running.
+    bool lead(const Key& key, uint64_t version) {
+        Shard& shard = shardFor(key);
+        lock_guard<mutex> lock(shard.lock);
+        return shard.flights.emplace(key, Flight{version, {}}).second;
+    }
+
+    // Parks waiter on a running flight; false if there is none for this
+    // version or it is full.
+    bool join(const Key& key, uint64_t version, const Waiter& waiter) {
+        Shard& shard = shardFor(key);
+        lock_guard<mutex> lock(shard.lock);
+        auto it = shard.flights.find(key);
+        if (it == shard.flights.end() || it->second.version != version) {
+            return false;
+        }
+        if (it->second.waiters.size() >= maxWaiters) {
+            refused++;
+            return false;
+        }
+        it->second.waiters.push_back(waiter);
+        joined++;
+        return true;
+    }
+
+    // Ends the flight and returns whoever joined it.
+    vector<Waiter> finish(const Key& key) {
+        Shard& shard = shardFor(key);
+        lock_guard<mutex> lock(shard.lock);
+        vector<Waiter> waiters;
+        auto it = shard.flights.find(key);
+        if (it != shard.flights.end()) {
+            waiters.swap(it->second.waiters);
+            shard.flights.erase(it);
+        }
+        return waiters;
+    }
+
+    long long getJoined() const { return joined.load(); }
+    long long getRefused() const { return refused.load(); }
+};
+
+#endif
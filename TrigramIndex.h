@@ -0,0 +1,323 @@
+#ifndef TRIGRAM_INDEX_H
+#define TRIGRAM_INDEX_H
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cctype>
+
+using namespace std;
+
+struct FuzzyMatch {
+    int id;
+    int distance;
+};
+
+// Sorted list of IDs stored as varint deltas. Every SKIP_INTERVAL entries a
+// skip records the ID and the byte offset just after it, so a reader can
+// gallop over the skips and only decode the block that can hold its target.
+class PostingList {
+private:
+    static const int SKIP_INTERVAL = 64;
+
+    struct Skip {
+        int id;
+        uint32_t offset;
+    };
+
+    vector<uint8_t> bytes;
+    vector<Skip> skips;
+    int lastId;
+    int count;
+
+    void putVarint(uint32_t value) {
+        while (value >= 0x80) {
+            bytes.push_back((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back((uint8_t)value);
+    }
+
+    void append(int id) {
+        putVarint((uint32_t)(id - lastId));
+        lastId = id;
+        count++;
+        if (count % SKIP_INTERVAL == 0) {
+            skips.push_back({id, (uint32_t)bytes.size()});
+        }
+    }
+
+public:
+    PostingList() : lastId(0), count(0) {}
+
+    int size() const { return count; }
+    size_t getMemoryBytes() const { return bytes.capacity() + skips.capacity() * sizeof(Skip); }
+
+    static uint32_t getVarint(const uint8_t* data, size_t& pos) {
+        uint32_t value = 0;
+        int shift = 0;
+        while (data[pos] & 0x80) {
+            value |= (uint32_t)(data[pos++] & 0x7F) << shift;
+            shift += 7;
+        }
+        value |= (uint32_t)data[pos++] << shift;
+        return value;
+    }
+
+    void decode(vector<int>& out) const {
+        size_t pos = 0;
+        int id = 0;
+        out.reserve(out.size() + count);
+        while (pos < bytes.size()) {
+            id += (int)getVarint(bytes.data(), pos);
+            out.push_back(id);
+        }
+    }
+
+    // IDs normally arrive in increasing order and are appended. An ID
+    // below the tail (an explicit-ID insert) rebuilds the list.
+    void add(int id) {
+        if (id > lastId) {
+            append(id);
+            return;
+        }
+
+        vector<int> ids;
+        decode(ids);
+        auto pos = lower_bound(ids.begin(), ids.end(), id);
+        if (pos != ids.end() && *pos == id) {
+            return;
+        }
+        ids.insert(pos, id);
+
+        bytes.clear();
+        skips.clear();
+        lastId = 0;
+        count = 0;
+        for (int value : ids) {
+            append(value);
+        }
+    }
+
+    // Forward-only reader for candidate checks in ascending ID order.
+    class Reader {
+    private:
+        const PostingList* list;
+        size_t skip;
+        size_t pos;
+        int current;
+        bool started;
+
+    public:
+        explicit Reader(const PostingList* l) : list(l), skip(0), pos(0), current(0), started(false) {}
+
+        // True when target is in the list. Targets must not decrease
+        // between calls.
+        bool advanceTo(int target) {
+            if (started && current >= target) {
+                return current == target;
+            }
+
+            // Gallop over the skips: double the step until it passes the
+            // target, then binary search the last step.
+            const vector<Skip>& skips = list->skips;
+            if (skip < skips.size() && skips[skip].id <= target) {
+                size_t lo = skip;
+                size_t step = 1;
+                while (lo + step < skips.size() && skips[lo + step].id <= target) {
+                    lo += step;
+                    step *= 2;
+                }
+                size_t hi = min(lo + step, skips.size());
+                while (hi - lo > 1) {
+                    size_t mid = (lo + hi) / 2;
+                    if (skips[mid].id <= target) lo = mid; else hi = mid;
+                }
+                if (!started || skips[lo].id > current) {
+                    current = skips[lo].id;
+                    pos = skips[lo].offset;
+                    started = true;
+                }
+                skip = lo + 1;
+                if (current == target) return true;
+            }
+
+            const vector<uint8_t>& bytes = list->bytes;
+            while (pos < bytes.size()) {
+                current += (int)getVarint(bytes.data(), pos);
+                started = true;
+                if (current >= target) {
+                    return current == target;
+                }
+            }
+            current = INT32_MAX;
+            started = true;
+            return false;
+        }
+    };
+};
+
+// Inverted index from the trigrams of a case-folded, padded name to the
+// IDs that contain them. search() keeps IDs sharing enough trigrams with the
+// query to be within maxEdits, then ranks them by edit distance.
+class TrigramIndex {
+private:
+    unordered_map<uint32_t, PostingList> postings;
+    int nameCount;
+
+    static void collectGrams(const string& text, vector<uint32_t>& grams) {
+        string padded = "  ";
+        for (char c : text) {
+            padded += (char)tolower((unsigned char)c);
+        }
+        padded += ' ';
+
+        for (size_t i = 0; i + 3 <= padded.size(); i++) {
+            grams.push_back(((uint32_t)(uint8_t)padded[i] << 16) |
+                            ((uint32_t)(uint8_t)padded[i + 1] << 8) |
+                            (uint32_t)(uint8_t)padded[i + 2]);
+        }
+        sort(grams.begin(), grams.end());
+        grams.erase(unique(grams.begin(), grams.end()), grams.end());
+    }
+
+public:
+    static const int MAX_CANDIDATES = 20000;
+
+    TrigramIndex() : nameCount(0) {}
+
+    void add(int id, const string& name) {
+        vector<uint32_t> grams;
+        collectGrams(name, grams);
+        for (uint32_t gram : grams) {
+            postings[gram].add(id);
+        }
+        nameCount++;
+    }
+
+    void clear() {
+        postings.clear();
+        nameCount = 0;
+    }
+
+    int getNameCount() const { return nameCount; }
+
+    size_t getMemoryBytes() const {
+        size_t total = postings.bucket_count() * sizeof(void*);
+        for (const auto& [gram, list] : postings) {
+            total += sizeof(gram) + sizeof(list) + sizeof(void*) + list.getMemoryBytes();
+        }
+        return total;
+    }
+
+    // Case-insensitive Levenshtein distance, or bound + 1 once it is
+    // certain to exceed bound.
+    static int editDistance(const string& a, const string& b, int bound) {
+        int n = (int)a.size(), m = (int)b.size();
+        if (abs(n - m) > bound) return bound + 1;
+
+        vector<int> prev(m + 1), cur(m + 1);
+        for (int j = 0; j <= m; j++) prev[j] = j;
+
+        for (int i = 1; i <= n; i++) {
+            cur[0] = i;
+            int rowMin = cur[0];
+            char ca = (char)tolower((unsigned char)a[i - 1]);
+            for (int j = 1; j <= m; j++) {
+                char cb = (char)tolower((unsigned char)b[j - 1]);
+                cur[j] = min({prev[j] + 1, cur[j - 1] + 1, prev[j - 1] + (ca == cb ? 0 : 1)});
+                rowMin = min(rowMin, cur[j]);
+            }
+            if (rowMin > bound) return bound + 1;
+            swap(prev, cur);
+        }
+        return prev[m];
+    }
+
+    // nameOf(id) returns a pointer to the current name or nullptr, so stale
+    // postings for renamed or removed IDs drop out during ranking.
+    template<typename NameLookup>
+    vector<FuzzyMatch> search(const string& query, int maxEdits, int limit, NameLookup nameOf) const {
+        vector<FuzzyMatch> matches;
+        vector<uint32_t> grams;
+        collectGrams(query, grams);
+
+        vector<const PostingList*> lists;
+        for (uint32_t gram : grams) {
+            auto it = postings.find(gram);
+            if (it != postings.end()) {
+                lists.push_back(&it->second);
+            }
+        }
+        if (lists.empty()) {
+            return matches;
+        }
+
+        // One edit touches at most three trigrams of the query.
+        int threshold = max(1, (int)grams.size() - 3 * maxEdits);
+        if ((int)lists.size() < threshold) {
+            return matches;
+        }
+
+        // Any ID with at least threshold grams appears in one of the
+        // (lists - threshold + 1) shortest lists; those generate candidates
+        // and the long lists are only probed.
+        sort(lists.begin(), lists.end(), [](const PostingList* a, const PostingList* b) {
+            return a->size() < b->size();
+        });
+        size_t generators = lists.size() - threshold + 1;
+
+        // Each decoded list is already sorted, so merge runs in place
+        // rather than sorting the concatenation.
+        vector<int> candidates;
+        for (size_t i = 0; i < generators; i++) {
+            size_t middle = candidates.size();
+            lists[i]->decode(candidates);
+            inplace_merge(candidates.begin(), candidates.begin() + middle, candidates.end());
+        }
+
+        vector<PostingList::Reader> probes;
+        for (size_t i = generators; i < lists.size(); i++) {
+            probes.emplace_back(lists[i]);
+        }
+
+        int checked = 0;
+        for (size_t i = 0; i < candidates.size() && checked < MAX_CANDIDATES; ) {
+            int id = candidates[i];
+            int shared = 0;
+            while (i < candidates.size() && candidates[i] == id) {
+                shared++;
+                i++;
+            }
+            for (size_t p = 0; p < probes.size() && shared + (int)(probes.size() - p) >= threshold; p++) {
+                if (probes[p].advanceTo(id)) shared++;
+            }
+            if (shared < threshold) {
+                continue;
+            }
+
+            checked++;
+            const string* name = nameOf(id);
+            if (name == nullptr) {
+                continue;
+            }
+            int distance = editDistance(query, *name, maxEdits);
+            if (distance <= maxEdits) {
+                matches.push_back({id, distance});
+            }
+        }
+
+        sort(matches.begin(), matches.end(), [](const FuzzyMatch& a, const FuzzyMatch& b) {
+            return a.distance != b.distance ? a.distance < b.distance : a.id < b.id;
+        });
+        if ((int)matches.size() > limit) {
+            matches.resize(limit);
+        }
+        return matches;
+    }
+};
+
+#endif
@@ -17,14 +17,20 @@ if %ERRORLEVEL% NEQ 0 (
     exit /b 1
 )
 
+REM -march=native enables the AVX2 B-tree key search on capable CPUs
+set CXXFLAGS=-std=c++17 -O2 -march=native
+
 echo Compiling server...
-g++ -std=c++17 -o server.exe ^
+g++ %CXXFLAGS% -o server.exe ^
     src\server.cpp ^
-    src\BTreeNode.cpp ^
-    src\BTree.cpp ^
     src\Graph.cpp ^
     src\Navigation.cpp ^
+    src\AdjacencyCache.cpp ^
+    src\RoadNetworkImporter.cpp ^
     src\DatabaseManager.cpp ^
+    src\Logger.cpp ^
+    src\ServerStats.cpp ^
+    src\RouteCache.cpp ^
     -lws2_32
 
 if %ERRORLEVEL% NEQ 0 (
@@ -36,7 +42,7 @@ echo Server compiled successfully: server.exe
 
 echo.
 echo Compiling client...
-g++ -std=c++17 -o client.exe src\client.cpp -lws2_32
+g++ %CXXFLAGS% -o client.exe src\client.cpp -lws2_32
 
 if %ERRORLEVEL% NEQ 0 (
     echo ERROR: Client compilation failed!
@@ -45,6 +51,48 @@ if %ERRORLEVEL% NEQ 0 (
 )
 echo Client compiled successfully: client.exe
 
+echo.
+echo Compiling benchmark...
+g++ %CXXFLAGS% -o benchmark.exe ^
+    src\benchmark.cpp ^
+    src\Graph.cpp ^
+    src\Navigation.cpp ^
+    src\AdjacencyCache.cpp ^
+    -lpsapi
+
+if %ERRORLEVEL% NEQ 0 (
+    echo ERROR: Benchmark compilation failed!
+    pause
+    exit /b 1
+)
+echo Benchmark compiled successfully: benchmark.exe
+
+echo.
+echo Compiling generator...
+g++ %CXXFLAGS% -o generator.exe ^
+    src\generator.cpp ^
+    src\Graph.cpp ^
+    src\Navigation.cpp ^
+    src\AdjacencyCache.cpp
+
+if %ERRORLEVEL% NEQ 0 (
+    echo ERROR: Generator compilation failed!
+    pause
+    exit /b 1
+)
+echo Generator compiled successfully: generator.exe
+
+echo.
+echo Compiling load generator...
+g++ %CXXFLAGS% -o loadgen.exe src\loadgen.cpp -lws2_32
+
+if %ERRORLEVEL% NEQ 0 (
+    echo ERROR: Load generator compilation failed!
+    pause
+    exit /b 1
+)
+echo Load generator compiled successfully: loadgen.exe
+
 echo.
 echo ============================================
 echo    Build Successful!
@@ -55,6 +103,15 @@ echo   1. Start server: server.exe
 echo   2. Start client: client.exe (in another terminal)
 echo.
 echo Multiple clients can connect simultaneously.
+echo Bulk import: client.exe --import FILE (live) or server.exe --import FILE (offline)
+echo Road networks: server.exe --import-dimacs FILE.gr FILE.co ^| --import-csv NODES.csv EDGES.csv
+echo Synthetic maps: generator.exe grid^|geometric --nodes N [--seed S] [--one-way F] [--out DIR]
+echo Benchmarks: benchmark.exe lookup^|concurrent^|alloc^|filter^|fuzzy [count ...]
+echo Load test: loadgen.exe --connections N [--rate R [--open]] [--duration S] [--mix find=60,get=30,road=10]
+echo Metrics: client menu option 9, or server.exe --metrics-file PATH for a Prometheus text dump
+echo Route profiling: FIND_PATH with explain=1; -DNAVIGATION_PROFILE=0 compiles the counters out
+echo Request tracing: add -DLOG_TRACE_SAMPLE=N to CXXFLAGS to log one request in N
+echo Routing suite: benchmark.exe suite [nodes] --json run.json, then benchmark.exe compare base.json run.json
 echo.
 
 pause
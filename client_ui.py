@@ -30,7 +30,10 @@ class RequestType(IntEnum):
     INIT_SAMPLE = 6
     SAVE_DATA = 7
     SHUTDOWN = 8
-    UNKNOWN = 9
+    SEARCH_LOCATION = 9
+    IMPORT = 10
+    STATS = 11
+    UNKNOWN = 12
 
 # Response status
 class ResponseStatus(IntEnum):
@@ -38,6 +41,7 @@ class ResponseStatus(IntEnum):
     FAILURE = 1
     NOT_FOUND = 2
     INVALID_PARAMS = 3
+    TIMEOUT = 4
 
 @dataclass
 class Response:
@@ -171,13 +175,39 @@ class NavigationClient:
             "destId": str(dest_id)
         })
     
+    def _get_all_pages(self, req_type: RequestType, noun: str) -> Optional[Response]:
+        """Fetch a listing page by page, following next= with after_id,
+        and join the pages into one response"""
+        items: List[str] = []
+        params: Dict[str, str] = {}
+        while True:
+            resp = self.send_request(req_type, params)
+            if not resp or resp.status != ResponseStatus.SUCCESS:
+                return resp
+            fields = dict(part.split("=", 1) for part in resp.data.split(";") if "=" in part)
+            if fields.get(noun):
+                items.extend(fields[noun].split(","))
+            if "next" not in fields:
+                resp.message = f"Retrieved {len(items)} {noun}"
+                resp.data = f"count={len(items)};{noun}=" + ",".join(items)
+                return resp
+            params = {"after_id": fields["next"]}
+    
     def get_locations(self) -> Optional[Response]:
         """Get all locations"""
-        return self.send_request(RequestType.GET_LOCATIONS)
+        return self._get_all_pages(RequestType.GET_LOCATIONS, "locations")
+    
+    def search_locations(self, prefix: str, limit: int = 10, fuzzy: bool = False) -> Optional[Response]:
+        """Find locations whose name starts with prefix, or is close to it when fuzzy"""
+        return self.send_request(RequestType.SEARCH_LOCATION, {
+            "prefix": prefix,
+            "limit": str(limit),
+            "fuzzy": "1" if fuzzy else "0"
+        })
     
     def get_roads(self) -> Optional[Response]:
         """Get all roads"""
-        return self.send_request(RequestType.GET_ROADS)
+        return self._get_all_pages(RequestType.GET_ROADS, "roads")
     
     def init_sample_data(self) -> Optional[Response]:
         """Initialize sample data"""
@@ -511,6 +541,19 @@ else:
                 if resp and resp.status == ResponseStatus.SUCCESS:
                     st.session_state.locations = parse_locations_data(resp.data)
             
+            search = st.text_input("Search by name", key="location_search")
+            if search:
+                resp = client.search_locations(search)
+                matches = []
+                if resp and resp.status == ResponseStatus.SUCCESS:
+                    matches = parse_locations_data(resp.data)
+                if not matches:
+                    resp = client.search_locations(search, fuzzy=True)
+                    if resp and resp.status == ResponseStatus.SUCCESS:
+                        matches = parse_locations_data(resp.data)
+                for loc_id, name in matches:
+                    st.markdown(f"**ID {loc_id}:** {name}")
+            
             for loc_id, name in st.session_state.locations:
                 st.markdown(f"""
                 <div class="location-card">
@@ -0,0 +1,40 @@
+#include "../AdjacencyCache.h"
+
+using namespace std;
+
+AdjacencyCache::AdjacencyCache(Loader l, size_t cap)
+    : loader(l), capacity(cap > 0 ? cap : 1), hits(0), misses(0) {}
+
+const vector<Neighbor>& AdjacencyCache::getNeighbors(int nodeId) {
+    auto it = entries.find(nodeId);
+    if (it != entries.end()) {
+        hits++;
+        recency.splice(recency.begin(), recency, it->second.position);
+        return it->second.neighbors;
+    }
+    
+    misses++;
+    if (entries.size() >= capacity) {
+        entries.erase(recency.back());
+        recency.pop_back();
+    }
+    
+    recency.push_front(nodeId);
+    Entry& entry = entries[nodeId];
+    entry.position = recency.begin();
+    loader(nodeId, entry.neighbors);
+    return entry.neighbors;
+}
+
+void AdjacencyCache::invalidate(int nodeId) {
+    auto it = entries.find(nodeId);
+    if (it != entries.end()) {
+        recency.erase(it->second.position);
+        entries.erase(it);
+    }
+}
+
+void AdjacencyCache::clear() {
+    recency.clear();
+    entries.clear();
+}
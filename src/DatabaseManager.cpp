@@ -1,16 +1,24 @@
 #include "../DatabaseManager.h"
 #include <iostream>
 #include <filesystem>
+#include <cctype>
+#include <cstdio>
+#include <thread>
+#include <algorithm>
+#include <climits>
 
 using namespace std;
 namespace fs = filesystem;
 
 DatabaseManager::DatabaseManager(const string& dataDir)
-    : locationBTree(nullptr), edgeBTree(nullptr), graph(nullptr),
-      dataDirectory(dataDir), nextLocationId(1), nextEdgeId(1), dataModified(false) {
+    : locationBTree(nullptr), edgeBTree(nullptr), locationIndex(nullptr), nameIndex(nullptr),
+      trigramIndex(nullptr), adjacencyIndex(nullptr), adjacencyCache(nullptr), graph(nullptr),
+      dataDirectory(dataDir), nextLocationId(1), nextEdgeId(1), dataModified(false),
+      lazyGraph(false), graphVersion(0) {
     
     locationFile = dataDirectory + "/locations_btree.dat";
     edgeFile = dataDirectory + "/edges_btree.dat";
+    adjacencyFile = dataDirectory + "/adjacency_btree.dat";
 }
 
 DatabaseManager::~DatabaseManager() {
@@ -20,6 +28,11 @@ DatabaseManager::~DatabaseManager() {
     
     delete locationBTree;
     delete edgeBTree;
+    delete locationIndex;
+    delete nameIndex;
+    delete trigramIndex;
+    delete adjacencyIndex;
+    delete adjacencyCache;
     delete graph;
 }
 
@@ -32,8 +45,19 @@ bool DatabaseManager::initialize() {
         fs::create_directories(dataDirectory);
     }
     
-    locationBTree = new BTree();
-    edgeBTree = new BTree();
+    locationBTree = new BTree<int, Location>();
+    edgeBTree = new BTree<int, Edge>();
+    // IDs are handed out sequentially, so an exact bitmap answers
+    // existence checks for unknown IDs without touching the trees.
+    locationBTree->setFilterMode(KeyFilterMode::DENSE_BITMAP);
+    edgeBTree->setFilterMode(KeyFilterMode::DENSE_BITMAP);
+    locationIndex = new ConcurrentBTree<int, Location>();
+    nameIndex = new BTree<string, int>();
+    trigramIndex = new TrigramIndex();
+    adjacencyIndex = new BTree<int64_t, Neighbor>();
+    adjacencyCache = new AdjacencyCache([this](int nodeId, vector<Neighbor>& out) {
+        loadNeighbors(nodeId, out);
+    });
     graph = new Graph();
     
     if (dataFilesExist()) {
@@ -44,30 +68,120 @@ bool DatabaseManager::initialize() {
     }
 }
 
+// The saved adjacency index is only trusted when it was written after the
+// edges, as saveData() does; an edge file written on its own (by an older
+// build, the generator, or a save outside lazy mode) makes it stale.
+bool DatabaseManager::adjacencyFileCurrent() {
+    error_code ec;
+    auto adjacencyTime = fs::last_write_time(adjacencyFile, ec);
+    if (ec) {
+        return false;
+    }
+    auto edgeTime = fs::last_write_time(edgeFile, ec);
+    return !ec && adjacencyTime >= edgeTime;
+}
+
 bool DatabaseManager::loadData() {
     bool success = true;
     
-    if (!locationBTree->loadFromFile(locationFile)) {
+    // The files are independent, so the edges and the adjacency index load
+    // on their own threads.
+    bool edgesLoaded = false;
+    thread edgeLoader([this, &edgesLoaded] {
+        edgesLoaded = edgeBTree->loadFromFile(edgeFile);
+    });
+    bool adjacencyLoaded = false;
+    thread adjacencyLoader;
+    if (lazyGraph && adjacencyFileCurrent()) {
+        adjacencyLoader = thread([this, &adjacencyLoaded] {
+            adjacencyLoaded = adjacencyIndex->loadFromFile(adjacencyFile);
+        });
+    }
+    bool locationsLoaded = locationBTree->loadFromFile(locationFile);
+    edgeLoader.join();
+    if (adjacencyLoader.joinable()) {
+        adjacencyLoader.join();
+    }
+    // Every road has at least one entry; fewer means a damaged file.
+    if (adjacencyLoaded && adjacencyIndex->getCount() < edgeBTree->getCount()) {
+        adjacencyLoaded = false;
+    }
+    
+    if (!locationsLoaded) {
         cerr << "Warning: Could not load locations file." << endl;
         success = false;
     }
     
-    if (!edgeBTree->loadFromFile(edgeFile)) {
+    if (!edgesLoaded) {
         cerr << "Warning: Could not load edges file." << endl;
         success = false;
     }
     
+    vector<Edge> noEdges;
+    rebuildIndexes(nullptr, adjacencyLoaded ? &noEdges : nullptr);
+    graphVersion++;
+    
     nextLocationId = locationBTree->getMaxKey() + 1;
     nextEdgeId = edgeBTree->getMaxKey() + 1;
     
-    buildGraph();
-    
     cout << "Data loaded: " << getLocationCount() << " locations, " 
          << getEdgeCount() << " roads." << endl;
     
     return success;
 }
 
+// Each derived structure only reads the two trees and writes its own
+// index, so they are rebuilt side by side while this thread builds the
+// graph. The concurrent location index serves lookups without g_dbMutex;
+// after an import it is only topped up with the added locations instead of
+// being cleared under its readers. Likewise the adjacency index only takes
+// addedEdges when given, so a loaded or imported-into index is not rebuilt
+// from a walk of every road.
+void DatabaseManager::rebuildIndexes(const vector<Location>* addedLocations,
+                                     const vector<Edge>* addedEdges) {
+    vector<thread> builders;
+    builders.emplace_back([this, addedLocations] {
+        if (addedLocations != nullptr) {
+            for (const Location& loc : *addedLocations) {
+                locationIndex->insert(loc.id, loc);
+            }
+            return;
+        }
+        locationIndex->clear();
+        for (auto it = locationBTree->begin(); it.valid(); it.next()) {
+            locationIndex->insert(it.key(), it.value());
+        }
+    });
+    builders.emplace_back([this] {
+        nameIndex->clear();
+        trigramIndex->clear();
+        for (auto it = locationBTree->begin(); it.valid(); it.next()) {
+            indexName(it.value());
+        }
+    });
+    builders.emplace_back([this, addedEdges] {
+        if (!lazyGraph) {
+            return;
+        }
+        if (addedEdges != nullptr) {
+            for (const Edge& edge : *addedEdges) {
+                indexEdge(edge);
+            }
+            return;
+        }
+        adjacencyIndex->clear();
+        adjacencyCache->clear();
+        for (auto it = edgeBTree->begin(); it.valid(); it.next()) {
+            indexEdge(it.value());
+        }
+    });
+    
+    buildGraph();
+    for (thread& builder : builders) {
+        builder.join();
+    }
+}
+
 bool DatabaseManager::saveData() {
     bool success = true;
     
@@ -81,6 +195,14 @@ bool DatabaseManager::saveData() {
         success = false;
     }
     
+    // Written after the edges so that its time stamp marks it current.
+    // Outside lazy mode there is no index to save and the old file is left
+    // behind as stale.
+    if (lazyGraph && !adjacencyIndex->saveToFile(adjacencyFile)) {
+        cerr << "Error: Could not save adjacency file." << endl;
+        success = false;
+    }
+    
     if (success) {
         dataModified = false;
         cout << "Data saved successfully." << endl;
@@ -96,10 +218,13 @@ int DatabaseManager::addLocation(const string& name, double lat, double lon, con
         return -1;
     }
     
-    locationBTree->insert(loc.id, loc.serialize());
+    locationBTree->insert(loc.id, loc);
+    locationIndex->insert(loc.id, loc);
+    indexName(loc);
     graph->addNode(loc);
     
     dataModified = true;
+    graphVersion++;
     return nextLocationId++;
 }
 
@@ -108,7 +233,9 @@ bool DatabaseManager::addLocation(const Location& location) {
         return false;
     }
     
-    locationBTree->insert(location.id, location.serialize());
+    locationBTree->insert(location.id, location);
+    locationIndex->insert(location.id, location);
+    indexName(location);
     graph->addNode(location);
     
     if (location.id >= nextLocationId) {
@@ -116,6 +243,7 @@ bool DatabaseManager::addLocation(const Location& location) {
     }
     
     dataModified = true;
+    graphVersion++;
     return true;
 }
 
@@ -131,10 +259,14 @@ int DatabaseManager::addEdge(int sourceId, int destId, double distance,
         return -1;
     }
     
-    edgeBTree->insert(edge.edgeId, edge.serialize());
-    graph->addEdge(sourceId, destId, distance, bidirectional);
+    edgeBTree->insert(edge.edgeId, edge);
+    indexEdge(edge);
+    if (!lazyGraph) {
+        graph->addEdge(sourceId, destId, distance, bidirectional);
+    }
     
     dataModified = true;
+    graphVersion++;
     return nextEdgeId++;
 }
 
@@ -143,31 +275,146 @@ bool DatabaseManager::addEdge(const Edge& edge) {
         return false;
     }
     
-    edgeBTree->insert(edge.edgeId, edge.serialize());
-    graph->addEdge(edge.sourceId, edge.destinationId, edge.distance, edge.isBidirectional);
+    edgeBTree->insert(edge.edgeId, edge);
+    indexEdge(edge);
+    if (!lazyGraph) {
+        graph->addEdge(edge.sourceId, edge.destinationId, edge.distance, edge.isBidirectional);
+    }
     
     if (edge.edgeId >= nextEdgeId) {
         nextEdgeId = edge.edgeId + 1;
     }
     
     dataModified = true;
+    graphVersion++;
     return true;
 }
 
-Location DatabaseManager::getLocation(int locationId) {
-    string data = locationBTree->search(locationId);
-    if (data.empty()) {
-        return Location();
+// Applies a whole batch or nothing: every record is validated first, then
+// the trees take plain inserts and the indexes and graph are rebuilt once
+// at the end instead of per record.
+// Gives the records of one import their IDs. The explicit IDs are looked
+// at first, so the ones handed to ID 0 records start above all of them as
+// well as above nextId and can never collide. batchIds receives every ID
+// of the batch, sorted. Fails on an ID given twice in the batch, or when
+// the IDs would run past INT_MAX; nextId only moves on success.
+template<typename T, typename IdOf>
+static bool assignImportIds(vector<T>& records, IdOf idOf, int& nextId, vector<int>& batchIds,
+                            const char* noun, string& error) {
+    batchIds.clear();
+    batchIds.reserve(records.size());
+    size_t autoCount = 0;
+    for (T& record : records) {
+        if (idOf(record) == 0) {
+            autoCount++;
+        } else {
+            batchIds.push_back(idOf(record));
+        }
+    }
+    sort(batchIds.begin(), batchIds.end());
+    auto duplicate = adjacent_find(batchIds.begin(), batchIds.end());
+    if (duplicate != batchIds.end()) {
+        error = "duplicate " + string(noun) + " " + to_string(*duplicate) + " in batch";
+        return false;
     }
-    return Location::deserialize(locationId, data);
+    
+    long long first = nextId;
+    if (!batchIds.empty() && batchIds.back() >= first) {
+        first = (long long)batchIds.back() + 1;
+    }
+    long long next = first + (long long)autoCount;
+    if (next - 1 > INT_MAX) {
+        error = string(noun) + " IDs exhausted";
+        return false;
+    }
+    
+    int id = (int)first;
+    for (T& record : records) {
+        if (idOf(record) == 0) {
+            idOf(record) = id;
+            batchIds.push_back(id++);
+        }
+    }
+    inplace_merge(batchIds.begin(), batchIds.end() - autoCount, batchIds.end());
+    nextId = (int)min(next, (long long)INT_MAX);
+    return true;
 }
 
-Edge DatabaseManager::getEdge(int edgeId) {
-    string data = edgeBTree->search(edgeId);
-    if (data.empty()) {
-        return Edge();
+bool DatabaseManager::importBatch(ImportBatch& batch, string& error) {
+    if (batch.failed()) {
+        error = batch.error;
+        return false;
+    }
+    
+    int locationId = nextLocationId;
+    vector<int> batchIds;
+    if (!assignImportIds(batch.locations, [](Location& loc) -> int& { return loc.id; },
+                         locationId, batchIds, "location", error)) {
+        return false;
+    }
+    for (const Location& loc : batch.locations) {
+        if (!loc.isValid()) {
+            error = "invalid location " + to_string(loc.id);
+            return false;
+        }
+    }
+    auto known = [&](int id) {
+        return locationBTree->exists(id) || binary_search(batchIds.begin(), batchIds.end(), id);
+    };
+    
+    int edgeId = nextEdgeId;
+    vector<int> edgeIds;
+    if (!assignImportIds(batch.edges, [](Edge& edge) -> int& { return edge.edgeId; },
+                         edgeId, edgeIds, "road", error)) {
+        return false;
+    }
+    for (const Edge& edge : batch.edges) {
+        if (!edge.isValid() || !known(edge.sourceId) || !known(edge.destinationId)) {
+            error = "invalid road " + to_string(edge.edgeId);
+            return false;
+        }
+    }
+    
+    // The adjacency index cannot drop a replaced road's old entries, so a
+    // batch that replaces roads rebuilds it instead of adding to it.
+    bool replacesEdges = false;
+    for (const Location& loc : batch.locations) {
+        locationBTree->insert(loc.id, loc);
+    }
+    for (const Edge& edge : batch.edges) {
+        replacesEdges = replacesEdges || edgeBTree->exists(edge.edgeId);
+        edgeBTree->insert(edge.edgeId, edge);
     }
-    return Edge::deserialize(edgeId, data);
+    nextLocationId = locationId;
+    nextEdgeId = edgeId;
+    
+    rebuildIndexes(&batch.locations, replacesEdges ? nullptr : &batch.edges);
+    
+    dataModified = true;
+    graphVersion++;
+    return true;
+}
+
+Location DatabaseManager::getLocation(int locationId) {
+    const Location* loc = findLocation(locationId);
+    return loc ? *loc : Location();
+}
+
+Edge DatabaseManager::getEdge(int edgeId) {
+    const Edge* edge = findEdge(edgeId);
+    return edge ? *edge : Edge();
+}
+
+const Location* DatabaseManager::findLocation(int locationId) const {
+    return locationBTree->find(locationId);
+}
+
+const Edge* DatabaseManager::findEdge(int edgeId) const {
+    return edgeBTree->find(edgeId);
+}
+
+bool DatabaseManager::lookupLocation(int locationId, Location& out) const {
+    return locationIndex->lookup(locationId, out);
 }
 
 bool DatabaseManager::locationExists(int locationId) {
@@ -180,10 +427,10 @@ bool DatabaseManager::edgeExists(int edgeId) {
 
 vector<Location> DatabaseManager::getAllLocations() {
     vector<Location> locations;
-    auto data = locationBTree->traverseAll();
+    locations.reserve(locationBTree->getCount());
     
-    for (const auto& pair : data) {
-        locations.push_back(Location::deserialize(pair.first, pair.second));
+    for (auto it = locationBTree->begin(); it.valid(); it.next()) {
+        locations.push_back(it.value());
     }
     
     return locations;
@@ -191,15 +438,116 @@ vector<Location> DatabaseManager::getAllLocations() {
 
 vector<Edge> DatabaseManager::getAllEdges() {
     vector<Edge> edges;
-    auto data = edgeBTree->traverseAll();
+    edges.reserve(edgeBTree->getCount());
     
-    for (const auto& pair : data) {
-        edges.push_back(Edge::deserialize(pair.first, pair.second));
+    for (auto it = edgeBTree->begin(); it.valid(); it.next()) {
+        edges.push_back(it.value());
     }
     
     return edges;
 }
 
+// Name index keys are the case-folded name, a NUL separator and the
+// zero-padded ID, so equal names stay distinct and sort by ID.
+string DatabaseManager::foldName(const string& name) {
+    string folded(name);
+    for (char& c : folded) {
+        c = (char)tolower((unsigned char)c);
+    }
+    return folded;
+}
+
+void DatabaseManager::indexName(const Location& location) {
+    char id[16];
+    snprintf(id, sizeof(id), "%010d", location.id);
+    nameIndex->insert(foldName(location.name) + '\0' + id, location.id);
+    trigramIndex->add(location.id, location.name);
+}
+
+vector<Location> DatabaseManager::searchLocations(const string& prefix, int limit) {
+    vector<Location> matches;
+    string folded = foldName(prefix);
+    
+    for (auto it = nameIndex->lowerBound(folded); it.valid() && (int)matches.size() < limit; it.next()) {
+        const string& key = it.key();
+        if (key.compare(0, folded.size(), folded) != 0) {
+            break;
+        }
+        
+        // A location re-added under a new name leaves its old key behind;
+        // skip entries whose name no longer matches the stored location.
+        const Location* loc = locationBTree->find(it.value());
+        if (loc == nullptr || key.compare(0, key.find('\0'), foldName(loc->name)) != 0) {
+            continue;
+        }
+        matches.push_back(*loc);
+    }
+    
+    return matches;
+}
+
+// Short queries allow one typo, longer ones two.
+vector<Location> DatabaseManager::fuzzySearchLocations(const string& query, int limit) {
+    vector<Location> matches;
+    int maxEdits = query.size() <= 4 ? 1 : 2;
+    
+    vector<FuzzyMatch> ranked = trigramIndex->search(query, maxEdits, limit,
+        [this](int id) -> const string* {
+            const Location* loc = locationBTree->find(id);
+            return loc ? &loc->name : nullptr;
+        });
+    
+    matches.reserve(ranked.size());
+    for (const FuzzyMatch& match : ranked) {
+        matches.push_back(*locationBTree->find(match.id));
+    }
+    
+    return matches;
+}
+
+// Adjacency keys put the node ID in the high half and the edge ID in the
+// low half, so one node's roads are contiguous in the index and a single
+// lowerBound plus a short cursor walk reads them all.
+int64_t DatabaseManager::adjacencyKey(int nodeId, int edgeId) {
+    return ((int64_t)nodeId << 32) | (uint32_t)edgeId;
+}
+
+// Only lazy mode reads the adjacency index, so nothing is indexed otherwise.
+void DatabaseManager::indexEdge(const Edge& edge) {
+    if (!lazyGraph) {
+        return;
+    }
+    adjacencyIndex->insert(adjacencyKey(edge.sourceId, edge.edgeId),
+                           Neighbor(edge.destinationId, edge.distance));
+    adjacencyCache->invalidate(edge.sourceId);
+    
+    if (edge.isBidirectional) {
+        adjacencyIndex->insert(adjacencyKey(edge.destinationId, edge.edgeId),
+                               Neighbor(edge.sourceId, edge.distance));
+        adjacencyCache->invalidate(edge.destinationId);
+    }
+}
+
+void DatabaseManager::loadNeighbors(int nodeId, vector<Neighbor>& out) const {
+    out.clear();
+    int64_t end = ((int64_t)nodeId + 1) << 32;
+    for (auto it = adjacencyIndex->lowerBound(adjacencyKey(nodeId, 0)); it.valid() && it.key() < end; it.next()) {
+        // Like Graph::addEdge, the first road between two nodes wins; the
+        // index is ordered by edge ID, so that is the oldest one.
+        const Neighbor& neighbor = it.value();
+        bool exists = false;
+        for (const Neighbor& seen : out) {
+            if (seen.nodeId == neighbor.nodeId) {
+                exists = true;
+                break;
+            }
+        }
+        if (!exists) {
+            out.push_back(neighbor);
+        }
+    }
+}
+
 int DatabaseManager::getLocationCount() {
     return locationBTree->getCount();
 }
@@ -209,24 +557,22 @@ int DatabaseManager::getEdgeCount() {
 }
 
 void DatabaseManager::buildGraph() {
-    graph->clear();
-    
-    for (const Location& loc : getAllLocations()) {
-        graph->addNode(loc);
-    }
-    
-    for (const Edge& edge : getAllEdges()) {
-        graph->addEdge(edge.sourceId, edge.destinationId, edge.distance, edge.isBidirectional);
-    }
+    graph->build(getAllLocations(), lazyGraph ? vector<Edge>() : getAllEdges());
 }
 
 void DatabaseManager::clearAll() {
     locationBTree->clear();
     edgeBTree->clear();
+    locationIndex->clear();
+    nameIndex->clear();
+    trigramIndex->clear();
+    adjacencyIndex->clear();
+    adjacencyCache->clear();
     graph->clear();
     nextLocationId = 1;
     nextEdgeId = 1;
     dataModified = true;
+    graphVersion++;
 }
 
 void DatabaseManager::initializeSampleData() {
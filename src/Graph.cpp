@@ -1,10 +1,11 @@
 #include "../Graph.h"
 #include <iostream>
 #include <algorithm>
+#include <tuple>
 
 using namespace std;
 
-Graph::Graph() {}
+Graph::Graph() : nodes(&arena), adjacencyList(&arena) {}
 
 Graph::~Graph() {
     clear();
@@ -13,21 +14,15 @@ Graph::~Graph() {
 void Graph::clear() {
     nodes.clear();
     adjacencyList.clear();
+    arena.release();
 }
 
 void Graph::addNode(const Location& location) {
     nodes[location.id] = location;
-    
-    if (adjacencyList.find(location.id) == adjacencyList.end()) {
-        adjacencyList[location.id] = vector<Neighbor>();
-    }
+    adjacencyList[location.id];
 }
 
 void Graph::addEdge(int sourceId, int destId, double distance, bool bidirectional) {
-    if (adjacencyList.find(sourceId) == adjacencyList.end()) {
-        adjacencyList[sourceId] = vector<Neighbor>();
-    }
-    
     bool exists = false;
     for (const auto& neighbor : adjacencyList[sourceId]) {
         if (neighbor.nodeId == destId) {
@@ -41,10 +36,6 @@ void Graph::addEdge(int sourceId, int destId, double distance, bool bidirectiona
     }
     
     if (bidirectional) {
-        if (adjacencyList.find(destId) == adjacencyList.end()) {
-            adjacencyList[destId] = vector<Neighbor>();
-        }
-        
         exists = false;
         for (const auto& neighbor : adjacencyList[destId]) {
             if (neighbor.nodeId == sourceId) {
@@ -59,6 +50,94 @@ void Graph::addEdge(int sourceId, int destId, double distance, bool bidirectiona
     }
 }
 
+// Bulk equivalent of addNode for every location followed by addEdge for
+// every edge, in order. Adjacency is laid out by a two-pass counting sort
+// (count degrees, then place) and duplicates are dropped with a per-node
+// stamp, so the first road between two nodes wins as it does in addEdge.
+void Graph::build(const vector<Location>& locations, const vector<Edge>& edges) {
+    clear();
+    
+    for (const Location& location : locations) {
+        nodes.emplace_hint(nodes.end(), location.id, location);
+    }
+    
+    vector<int> ids;
+    ids.reserve(nodes.size());
+    for (const auto& pair : nodes) {
+        ids.push_back(pair.first);
+    }
+    int n = ids.size();
+    
+    auto indexOf = [&ids](int id) {
+        auto it = lower_bound(ids.begin(), ids.end(), id);
+        return (it != ids.end() && *it == id) ? (int)(it - ids.begin()) : -1;
+    };
+    
+    // Pass 1: out-degree per node, reverse direction included.
+    vector<int> offsets(n + 1, 0);
+    vector<pair<int, int>> endpoints(edges.size());
+    vector<const Edge*> unknown;
+    for (size_t i = 0; i < edges.size(); i++) {
+        const Edge& edge = edges[i];
+        int source = indexOf(edge.sourceId);
+        int dest = indexOf(edge.destinationId);
+        endpoints[i] = {source, dest};
+        if (source < 0 || dest < 0) {
+            unknown.push_back(&edge);
+            continue;
+        }
+        offsets[source + 1]++;
+        if (edge.isBidirectional) {
+            offsets[dest + 1]++;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        offsets[i + 1] += offsets[i];
+    }
+    
+    // Pass 2: place each direction in its node's slice, in edge order.
+    vector<int> slotTarget(offsets[n]);
+    vector<double> slotDistance(offsets[n]);
+    vector<int> next(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < edges.size(); i++) {
+        auto [source, dest] = endpoints[i];
+        if (source < 0 || dest < 0) continue;
+        
+        int slot = next[source]++;
+        slotTarget[slot] = dest;
+        slotDistance[slot] = edges[i].distance;
+        if (edges[i].isBidirectional) {
+            slot = next[dest]++;
+            slotTarget[slot] = source;
+            slotDistance[slot] = edges[i].distance;
+        }
+    }
+    
+    vector<int> seenBy(n, -1);
+    for (int u = 0; u < n; u++) {
+        auto& list = adjacencyList.emplace_hint(adjacencyList.end(), piecewise_construct,
+                                                forward_as_tuple(ids[u]), forward_as_tuple())->second;
+        int kept = 0;
+        for (int slot = offsets[u]; slot < offsets[u + 1]; slot++) {
+            if (seenBy[slotTarget[slot]] != u) {
+                seenBy[slotTarget[slot]] = u;
+                slotTarget[offsets[u] + kept] = slotTarget[slot];
+                slotDistance[offsets[u] + kept] = slotDistance[slot];
+                kept++;
+            }
+        }
+        list.reserve(kept);
+        for (int slot = offsets[u]; slot < offsets[u] + kept; slot++) {
+            list.push_back(Neighbor(ids[slotTarget[slot]], slotDistance[slot]));
+        }
+    }
+    
+    // Roads whose endpoints are not locations keep the incremental path.
+    for (const Edge* edge : unknown) {
+        addEdge(edge->sourceId, edge->destinationId, edge->distance, edge->isBidirectional);
+    }
+}
+
 bool Graph::nodeExists(int nodeId) const {
     return nodes.find(nodeId) != nodes.end();
 }
@@ -71,10 +150,15 @@ Location Graph::getNode(int nodeId) const {
     return Location();
 }
 
+const Location* Graph::findNode(int nodeId) const {
+    auto it = nodes.find(nodeId);
+    return it != nodes.end() ? &it->second : nullptr;
+}
+
 vector<Neighbor> Graph::getNeighbors(int nodeId) const {
     auto it = adjacencyList.find(nodeId);
     if (it != adjacencyList.end()) {
-        return it->second;
+        return vector<Neighbor>(it->second.begin(), it->second.end());
     }
     return vector<Neighbor>();
 }
@@ -0,0 +1,224 @@
+#include "../Logger.h"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <cstdio>
+
+using namespace std;
+
+namespace {
+
+int64_t nowMicros() {
+    return chrono::duration_cast<chrono::microseconds>(
+        chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Owns the calling thread's ring; marks it retired when the thread exits
+// so the logger frees it once drained.
+struct ThreadBufferHolder {
+    LogBuffer* buffer = nullptr;
+
+    ~ThreadBufferHolder() {
+        if (buffer != nullptr) {
+            buffer->retired.store(true, memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadBufferHolder t_buffer;
+
+const char* levelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::TRACE: return "TRACE ";
+        case LogLevel::WARN: return "WARN ";
+        case LogLevel::FAILURE: return "ERROR ";
+        default: return "";
+    }
+}
+
+}
+
+Logger::Logger()
+    : level(LOG_TRACE_SAMPLE > 0 ? LogLevel::TRACE : LogLevel::INFO),
+      ratePerSecond(DEFAULT_LOG_RATE_PER_SECOND), burst(DEFAULT_LOG_BURST),
+      flushRequests(0), flushesDone(0), stopping(false) {
+    drainThread = thread(&Logger::run, this);
+}
+
+Logger::~Logger() {
+    stop();
+    for (LogBuffer* buffer : buffers) {
+        delete buffer;
+    }
+}
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+LogBuffer* Logger::threadBuffer() {
+    if (t_buffer.buffer == nullptr) {
+        LogBuffer* buffer = new LogBuffer();
+        buffer->lastRefillMicros = nowMicros();
+        lock_guard<mutex> lock(registryMutex);
+        buffers.push_back(buffer);
+        t_buffer.buffer = buffer;
+    }
+    return t_buffer.buffer;
+}
+
+bool Logger::takeToken(LogBuffer* buffer, int64_t now) {
+    int rate = ratePerSecond.load(memory_order_relaxed);
+    if (rate <= 0) {
+        return true;
+    }
+    double elapsed = (now - buffer->lastRefillMicros) / 1e6;
+    buffer->lastRefillMicros = now;
+    buffer->tokens = min((double)burst.load(memory_order_relaxed), buffer->tokens + elapsed * rate);
+    if (buffer->tokens < 1.0) {
+        return false;
+    }
+    buffer->tokens -= 1.0;
+    return true;
+}
+
+void Logger::write(LogLevel messageLevel, const string& message) {
+    if (!isEnabled(messageLevel)) {
+        return;
+    }
+
+    LogBuffer* buffer = threadBuffer();
+    int64_t now = nowMicros();
+    if (messageLevel < LogLevel::WARN && !takeToken(buffer, now)) {
+        buffer->suppressed.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+
+    uint64_t head = buffer->head.load(memory_order_relaxed);
+    if (head - buffer->tail.load(memory_order_acquire) >= (uint64_t)LOG_BUFFER_RECORDS) {
+        buffer->dropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+
+    LogRecord& record = buffer->records[head % LOG_BUFFER_RECORDS];
+    record.timeMicros = now;
+    record.level = messageLevel;
+    record.length = (int)min(message.size(), (size_t)LOG_MESSAGE_BYTES);
+    memcpy(record.text, message.data(), record.length);
+    buffer->head.store(head + 1, memory_order_release);
+}
+
+void Logger::setRateLimit(int perSecond, int burstSize) {
+    ratePerSecond.store(perSecond);
+    burst.store(max(1, burstSize));
+}
+
+void Logger::drain() {
+    vector<LogBuffer*> current;
+    {
+        lock_guard<mutex> lock(registryMutex);
+        current = buffers;
+    }
+
+    vector<LogRecord> batch;
+    uint64_t dropped = 0, suppressed = 0;
+    for (LogBuffer* buffer : current) {
+        uint64_t tail = buffer->tail.load(memory_order_relaxed);
+        uint64_t head = buffer->head.load(memory_order_acquire);
+        for (; tail < head; tail++) {
+            batch.push_back(buffer->records[tail % LOG_BUFFER_RECORDS]);
+        }
+        buffer->tail.store(tail, memory_order_release);
+        dropped += buffer->dropped.exchange(0, memory_order_relaxed);
+        suppressed += buffer->suppressed.exchange(0, memory_order_relaxed);
+    }
+
+    // Rings of finished threads are freed once empty. retired is set
+    // after the thread's last write, so nothing can follow it.
+    {
+        lock_guard<mutex> lock(registryMutex);
+        buffers.erase(remove_if(buffers.begin(), buffers.end(), [](LogBuffer* buffer) {
+            if (!buffer->retired.load(memory_order_acquire) ||
+                buffer->head.load(memory_order_acquire) != buffer->tail.load(memory_order_relaxed)) {
+                return false;
+            }
+            delete buffer;
+            return true;
+        }), buffers.end());
+    }
+
+    if (batch.empty() && dropped == 0 && suppressed == 0) {
+        return;
+    }
+
+    stable_sort(batch.begin(), batch.end(), [](const LogRecord& a, const LogRecord& b) {
+        return a.timeMicros < b.timeMicros;
+    });
+
+    // localtime is only called here, once per distinct second.
+    string out;
+    time_t lastSecond = -1;
+    char stamp[16] = "";
+    for (const LogRecord& record : batch) {
+        time_t second = (time_t)(record.timeMicros / 1000000);
+        if (second != lastSecond) {
+            strftime(stamp, sizeof(stamp), "%H:%M:%S", localtime(&second));
+            lastSecond = second;
+        }
+        out += "[";
+        out += stamp;
+        out += "] ";
+        out += levelName(record.level);
+        out.append(record.text, record.length);
+        out += '\n';
+    }
+    if (dropped > 0 || suppressed > 0) {
+        out += "[logger] " + to_string(dropped) + " messages dropped (buffer full), " +
+               to_string(suppressed) + " suppressed by rate limit\n";
+    }
+    cout << out;
+    cout.flush();
+}
+
+void Logger::run() {
+    unique_lock<mutex> lock(wakeMutex);
+    while (true) {
+        wake.wait_for(lock, chrono::milliseconds(LOG_FLUSH_INTERVAL_MS),
+                      [this] { return stopping || flushRequests > flushesDone; });
+        bool exiting = stopping;
+        uint64_t requested = flushRequests;
+        lock.unlock();
+
+        drain();
+
+        lock.lock();
+        flushesDone = requested;
+        flushed.notify_all();
+        if (exiting) break;
+    }
+}
+
+void Logger::flush() {
+    unique_lock<mutex> lock(wakeMutex);
+    if (stopping) {
+        return;
+    }
+    uint64_t ticket = ++flushRequests;
+    wake.notify_one();
+    flushed.wait(lock, [this, ticket] { return flushesDone >= ticket || stopping; });
+}
+
+void Logger::stop() {
+    {
+        lock_guard<mutex> lock(wakeMutex);
+        if (stopping) return;
+        stopping = true;
+    }
+    wake.notify_one();
+    if (drainThread.joinable()) {
+        drainThread.join();
+    }
+}
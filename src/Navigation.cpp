@@ -5,13 +5,37 @@
 #include <limits>
 #include <cmath>
 #include <algorithm>
+#include <chrono>
 
 using namespace std;
 
-Navigation::Navigation(Graph* g) : graph(g) {}
+#if NAVIGATION_PROFILE
+    #define PROFILE_COUNT(profile, counter) ((profile).counter++)
+    #define PROFILE_MAX(profile, counter, value) \
+        ((profile).counter = max((profile).counter, (value)))
+    #define PROFILE_CLOCK(name) auto name = chrono::steady_clock::now()
+    #define PROFILE_PHASE(profile, field, since) \
+        ((profile).field = chrono::duration_cast<chrono::microseconds>( \
+            chrono::steady_clock::now() - (since)).count())
+#else
+    #define PROFILE_COUNT(profile, counter) ((void)0)
+    #define PROFILE_MAX(profile, counter, value) ((void)0)
+    #define PROFILE_CLOCK(name) ((void)0)
+    #define PROFILE_PHASE(profile, field, since) ((void)0)
+#endif
+
+Navigation::Navigation(Graph* g, AdjacencyCache* a) : graph(g), adjacency(a) {}
 
 Navigation::~Navigation() {}
 
+const vector<Neighbor>& Navigation::neighborsOf(int nodeId) {
+    if (adjacency != nullptr) {
+        return adjacency->getNeighbors(nodeId);
+    }
+    scratch = graph->getNeighbors(nodeId);
+    return scratch;
+}
+
 vector<int> Navigation::reconstructPath(const map<int, int>& previous, int start, int end) {
     vector<int> path;
     int current = end;
@@ -30,8 +54,10 @@ vector<int> Navigation::reconstructPath(const map<int, int>& previous, int start
     return path;
 }
 
-PathResult Navigation::dijkstra(int sourceId, int destinationId) {
+PathResult Navigation::dijkstra(int sourceId, int destinationId, const CancellationToken& token) {
     PathResult result;
+    PROFILE_CLOCK(setupStart);
+    result.profile.engine = adjacency != nullptr ? "dijkstra+adjacency-cache" : "dijkstra+graph";
     
     if (graph == nullptr || graph->isEmpty()) {
         result.errorMessage = "Graph is empty. Add locations first.";
@@ -55,53 +81,73 @@ PathResult Navigation::dijkstra(int sourceId, int destinationId) {
         return result;
     }
     
-    const double INFINITY_DIST = numeric_limits<double>::infinity();
-    
+    // Only nodes the search reaches get an entry; a missing distance is
+    // infinite.
     map<int, double> distances;
     map<int, int> previous;
     set<int> visited;
     
     priority_queue<pair<double, int>, vector<pair<double, int>>, greater<pair<double, int>>> pq;
     
-    for (const Location& loc : graph->getAllNodes()) {
-        distances[loc.id] = INFINITY_DIST;
-        previous[loc.id] = -1;
-    }
-    
     distances[sourceId] = 0;
+    previous[sourceId] = -1;
     pq.push({0.0, sourceId});
+    PROFILE_COUNT(result.profile, heapPushes);
+    PROFILE_MAX(result.profile, maxFrontier, pq.size());
+    PROFILE_PHASE(result.profile, setupMicros, setupStart);
+    PROFILE_CLOCK(searchStart);
     
     while (!pq.empty()) {
         auto [currentDist, currentNode] = pq.top();
         pq.pop();
+        PROFILE_COUNT(result.profile, heapPops);
         
         if (visited.count(currentNode)) {
             continue;
         }
         
         if (currentNode == destinationId) {
+            PROFILE_PHASE(result.profile, searchMicros, searchStart);
+            PROFILE_CLOCK(pathStart);
             result.found = true;
             result.path = reconstructPath(previous, sourceId, destinationId);
             result.totalDistance = distances[destinationId];
+            PROFILE_PHASE(result.profile, pathMicros, pathStart);
+            return result;
+        }
+        
+        if ((result.nodesSettled & (CANCEL_CHECK_INTERVAL - 1)) == 0 && token.shouldStop()) {
+            PROFILE_PHASE(result.profile, searchMicros, searchStart);
+            result.aborted = true;
+            result.errorMessage = token.isCancelled()
+                ? "Search cancelled"
+                : "Search deadline exceeded after " + to_string(result.nodesSettled) + " nodes";
             return result;
         }
         
         visited.insert(currentNode);
+        result.nodesSettled++;
         
-        for (const Neighbor& neighbor : graph->getNeighbors(currentNode)) {
+        for (const Neighbor& neighbor : neighborsOf(currentNode)) {
+            PROFILE_COUNT(result.profile, edgesScanned);
             if (visited.count(neighbor.nodeId)) {
                 continue;
             }
             
             double newDist = currentDist + neighbor.distance;
+            auto known = distances.find(neighbor.nodeId);
             
-            if (newDist < distances[neighbor.nodeId]) {
+            if (known == distances.end() || newDist < known->second) {
                 distances[neighbor.nodeId] = newDist;
                 previous[neighbor.nodeId] = currentNode;
                 pq.push({newDist, neighbor.nodeId});
+                PROFILE_COUNT(result.profile, edgesRelaxed);
+                PROFILE_COUNT(result.profile, heapPushes);
+                PROFILE_MAX(result.profile, maxFrontier, pq.size());
             }
         }
     }
+    PROFILE_PHASE(result.profile, searchMicros, searchStart);
     
     result.errorMessage = "No path found from " + graph->getNode(sourceId).name + 
                           " to " + graph->getNode(destinationId).name + ".";
@@ -131,7 +177,7 @@ vector<string> Navigation::getDirections(const PathResult& result) {
         Location to = graph->getNode(toId);
         
         double segmentDist = 0.0;
-        for (const Neighbor& n : graph->getNeighbors(fromId)) {
+        for (const Neighbor& n : neighborsOf(fromId)) {
             if (n.nodeId == toId) {
                 segmentDist = n.distance;
                 break;
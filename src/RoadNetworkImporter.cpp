@@ -0,0 +1,331 @@
+#include "../RoadNetworkImporter.h"
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#include <charconv>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cctype>
+
+using namespace std;
+
+const double RoadNetworkImporter::DEFAULT_DIMACS_WEIGHT_SCALE = 0.001;
+
+MappedFile::MappedFile() : data(nullptr), length(0) {
+#ifdef _WIN32
+    fileHandle = INVALID_HANDLE_VALUE;
+    mappingHandle = nullptr;
+#endif
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const string& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER fileSize;
+        if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping != nullptr) {
+                void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                if (view != nullptr) {
+                    fileHandle = file;
+                    mappingHandle = mapping;
+                    data = static_cast<const char*>(view);
+                    length = (size_t)fileSize.QuadPart;
+                    return true;
+                }
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view != MAP_FAILED) {
+                madvise(view, (size_t)info.st_size, MADV_SEQUENTIAL);
+                ::close(fd);
+                data = static_cast<const char*>(view);
+                length = (size_t)info.st_size;
+                return true;
+            }
+        }
+        ::close(fd);
+    }
+#endif
+
+    ifstream file(path, ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    ostringstream contents;
+    contents << file.rdbuf();
+    fallback = contents.str();
+    data = fallback.data();
+    length = fallback.size();
+    return true;
+}
+
+void MappedFile::close() {
+    if (data != nullptr && data != fallback.data()) {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+        CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+        mappingHandle = nullptr;
+        fileHandle = INVALID_HANDLE_VALUE;
+#else
+        munmap(const_cast<char*>(data), length);
+#endif
+    }
+    fallback.clear();
+    data = nullptr;
+    length = 0;
+}
+
+namespace {
+
+const size_t MIN_CHUNK_BYTES = 1 << 20;
+
+const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    return p;
+}
+
+template<typename T>
+bool readNumber(const char*& p, const char* end, T& value) {
+    p = skipSpaces(p, end);
+    auto result = from_chars(p, end, value);
+    if (result.ec != errc()) {
+        return false;
+    }
+    p = result.ptr;
+    return true;
+}
+
+// Next comma-separated field, trimmed of surrounding blanks.
+string readField(const char*& p, const char* end) {
+    p = skipSpaces(p, end);
+    const char* start = p;
+    while (p < end && *p != ',') p++;
+    const char* stop = p;
+    while (stop > start && (stop[-1] == ' ' || stop[-1] == '\t')) stop--;
+    if (p < end) p++;
+
+    // '|' separates fields in the .dat files.
+    string field(start, stop);
+    replace(field.begin(), field.end(), '|', '/');
+    return field;
+}
+
+bool startsWithNumber(const char* p, const char* end) {
+    p = skipSpaces(p, end);
+    return p < end && (isdigit((unsigned char)*p) || *p == '-');
+}
+
+const char* skipLine(const char* p, const char* end) {
+    while (p < end && *p != '\n') p++;
+    return p < end ? p + 1 : end;
+}
+
+// Splits the file into newline-aligned chunks, one per thread, and parses
+// them in parallel. parseLine(begin, end, out) handles one line without its
+// terminator and returns false if the line is malformed. Chunk results are
+// appended to out in file order.
+template<typename T, typename ParseLine>
+bool parseChunks(const char* begin, const char* end, vector<T>& out, string& error,
+                 ParseLine parseLine) {
+    size_t threads = max(1u, thread::hardware_concurrency());
+    threads = max((size_t)1, min(threads, (size_t)(end - begin) / MIN_CHUNK_BYTES));
+
+    vector<const char*> bounds(1, begin);
+    for (size_t t = 1; t < threads; t++) {
+        const char* cut = begin + (end - begin) * t / threads;
+        cut = max(cut, bounds.back());
+        bounds.push_back(skipLine(cut, end));
+    }
+    bounds.push_back(end);
+
+    vector<vector<T>> results(threads);
+    vector<string> errors(threads);
+    auto work = [&](size_t t) {
+        const char* p = bounds[t];
+        while (p < bounds[t + 1] && errors[t].empty()) {
+            const char* lineEnd = p;
+            while (lineEnd < bounds[t + 1] && *lineEnd != '\n') lineEnd++;
+            const char* next = lineEnd < bounds[t + 1] ? lineEnd + 1 : lineEnd;
+            if (lineEnd > p && lineEnd[-1] == '\r') lineEnd--;
+
+            if (lineEnd > p && !parseLine(p, lineEnd, results[t])) {
+                errors[t] = "malformed line: " + string(p, min(lineEnd, p + 60));
+            }
+            p = next;
+        }
+    };
+
+    vector<thread> workers;
+    for (size_t t = 1; t < threads; t++) {
+        workers.emplace_back(work, t);
+    }
+    work(0);
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    for (size_t t = 0; t < threads; t++) {
+        if (!errors[t].empty()) {
+            error = errors[t];
+            return false;
+        }
+    }
+
+    size_t total = out.size();
+    for (const auto& part : results) total += part.size();
+    out.reserve(total);
+    for (auto& part : results) {
+        move(part.begin(), part.end(), back_inserter(out));
+    }
+    return true;
+}
+
+bool openInput(MappedFile& file, const string& path, string& error) {
+    if (!file.open(path)) {
+        error = "cannot open " + path;
+        return false;
+    }
+    return true;
+}
+
+}
+
+bool RoadNetworkImporter::loadDimacs(const string& grPath, const string& coPath, ImportBatch& batch,
+                                     string& error, double weightScale) {
+    MappedFile coordinates;
+    if (!openInput(coordinates, coPath, error)) return false;
+
+    bool ok = parseChunks(coordinates.begin(), coordinates.end(), batch.locations, error,
+        [](const char* p, const char* end, vector<Location>& out) {
+            if (*p != 'v') return *p == 'c' || *p == 'p';
+            long long id, x, y;
+            p++;
+            if (!readNumber(p, end, id) || !readNumber(p, end, x) || !readNumber(p, end, y)) {
+                return false;
+            }
+            out.emplace_back((int)id, "Node " + to_string(id), y / 1e6, x / 1e6, "node");
+            return true;
+        });
+    coordinates.close();
+    if (!ok) {
+        error = coPath + ": " + error;
+        return false;
+    }
+
+    MappedFile arcs;
+    if (!openInput(arcs, grPath, error)) return false;
+
+    ok = parseChunks(arcs.begin(), arcs.end(), batch.edges, error,
+        [weightScale](const char* p, const char* end, vector<Edge>& out) {
+            if (*p != 'a') return *p == 'c' || *p == 'p';
+            long long from, to;
+            double weight;
+            p++;
+            if (!readNumber(p, end, from) || !readNumber(p, end, to) || !readNumber(p, end, weight)) {
+                return false;
+            }
+            out.emplace_back(0, (int)from, (int)to, weight * weightScale, "", false);
+            return true;
+        });
+    if (!ok) {
+        error = grPath + ": " + error;
+    }
+    return ok;
+}
+
+bool RoadNetworkImporter::loadCsv(const string& nodesPath, const string& edgesPath, ImportBatch& batch,
+                                  string& error) {
+    MappedFile nodes;
+    if (!openInput(nodes, nodesPath, error)) return false;
+
+    const char* start = nodes.begin();
+    if (!startsWithNumber(start, nodes.end())) {
+        start = skipLine(start, nodes.end());
+    }
+    bool ok = parseChunks(start, nodes.end(), batch.locations, error,
+        [](const char* p, const char* end, vector<Location>& out) {
+            long long id;
+            if (!readNumber(p, end, id)) return false;
+            p = skipSpaces(p, end);
+            if (p == end || *p++ != ',') return false;
+
+            string name = readField(p, end);
+            double lat, lon;
+            if (!readNumber(p, end, lat)) return false;
+            p = skipSpaces(p, end);
+            if (p == end || *p++ != ',') return false;
+            if (!readNumber(p, end, lon)) return false;
+            p = skipSpaces(p, end);
+            if (p < end && *p == ',') p++;
+
+            string type = readField(p, end);
+            out.emplace_back((int)id, name, lat, lon, type.empty() ? "node" : type);
+            return true;
+        });
+    nodes.close();
+    if (!ok) {
+        error = nodesPath + ": " + error;
+        return false;
+    }
+
+    MappedFile edges;
+    if (!openInput(edges, edgesPath, error)) return false;
+
+    start = edges.begin();
+    if (!startsWithNumber(start, edges.end())) {
+        start = skipLine(start, edges.end());
+    }
+    ok = parseChunks(start, edges.end(), batch.edges, error,
+        [](const char* p, const char* end, vector<Edge>& out) {
+            long long source, dest;
+            double distance;
+            if (!readNumber(p, end, source)) return false;
+            p = skipSpaces(p, end);
+            if (p == end || *p++ != ',') return false;
+            if (!readNumber(p, end, dest)) return false;
+            p = skipSpaces(p, end);
+            if (p == end || *p++ != ',') return false;
+            if (!readNumber(p, end, distance)) return false;
+            p = skipSpaces(p, end);
+            if (p < end && *p == ',') p++;
+
+            string roadName = readField(p, end);
+            string bidirectional = readField(p, end);
+            out.emplace_back(0, (int)source, (int)dest, distance, roadName,
+                             bidirectional.empty() || bidirectional == "1" || bidirectional == "true");
+            return true;
+        });
+    if (!ok) {
+        error = edgesPath + ": " + error;
+    }
+    return ok;
+}
@@ -0,0 +1,121 @@
+#include "../RouteCache.h"
+#include <algorithm>
+
+using namespace std;
+
+RouteCache::RouteCache(size_t maxBytes)
+    : shardBudget(max((size_t)1, maxBytes / ROUTE_CACHE_SHARDS)) {}
+
+void RouteCache::advanceVersion(Shard& shard, uint64_t version) {
+    if (version > shard.version) {
+        shard.recency.clear();
+        shard.entries.clear();
+        shard.bytes = 0;
+        shard.version = version;
+    }
+}
+
+// Rough footprint: the entry and its node in the map and the list, plus
+// the shared route with what it owns on the heap.
+size_t RouteCache::entryBytes(const CachedRoute& route) {
+    return sizeof(Entry) + sizeof(RouteKey) * 2 + 4 * sizeof(void*) + sizeof(CachedRoute) +
+           route.result.path.capacity() * sizeof(int) + route.result.errorMessage.capacity() +
+           route.payload.capacity();
+}
+
+bool RouteCache::lookup(const RouteKey& key, uint64_t graphVersion, shared_ptr<const CachedRoute>& out) {
+    Shard& shard = shardFor(key);
+    lock_guard<mutex> lock(shard.lock);
+    advanceVersion(shard, graphVersion);
+
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end() || graphVersion < shard.version) {
+        shard.misses++;
+        return false;
+    }
+
+    shard.hits++;
+    shard.recency.splice(shard.recency.begin(), shard.recency, it->second.position);
+    out = it->second.route;
+    return true;
+}
+
+void RouteCache::insert(const RouteKey& key, uint64_t graphVersion, const shared_ptr<const CachedRoute>& route) {
+    Shard& shard = shardFor(key);
+    lock_guard<mutex> lock(shard.lock);
+    advanceVersion(shard, graphVersion);
+    if (graphVersion < shard.version) {
+        return;
+    }
+
+    size_t bytes = entryBytes(*route);
+    if (bytes > shardBudget) {
+        return;
+    }
+
+    auto existing = shard.entries.find(key);
+    if (existing != shard.entries.end()) {
+        shard.bytes -= existing->second.bytes;
+        shard.recency.erase(existing->second.position);
+        shard.entries.erase(existing);
+    }
+
+    while (shard.bytes + bytes > shardBudget && !shard.recency.empty()) {
+        auto oldest = shard.entries.find(shard.recency.back());
+        shard.bytes -= oldest->second.bytes;
+        shard.entries.erase(oldest);
+        shard.recency.pop_back();
+    }
+
+    shard.recency.push_front(key);
+    Entry& entry = shard.entries[key];
+    entry.route = route;
+    entry.bytes = bytes;
+    entry.position = shard.recency.begin();
+    shard.bytes += bytes;
+}
+
+void RouteCache::clear() {
+    for (Shard& shard : shards) {
+        lock_guard<mutex> lock(shard.lock);
+        shard.recency.clear();
+        shard.entries.clear();
+        shard.bytes = 0;
+    }
+}
+
+size_t RouteCache::getSize() {
+    size_t total = 0;
+    for (Shard& shard : shards) {
+        lock_guard<mutex> lock(shard.lock);
+        total += shard.entries.size();
+    }
+    return total;
+}
+
+size_t RouteCache::getBytes() {
+    size_t total = 0;
+    for (Shard& shard : shards) {
+        lock_guard<mutex> lock(shard.lock);
+        total += shard.bytes;
+    }
+    return total;
+}
+
+long long RouteCache::getHits() {
+    long long total = 0;
+    for (Shard& shard : shards) {
+        lock_guard<mutex> lock(shard.lock);
+        total += shard.hits;
+    }
+    return total;
+}
+
+long long RouteCache::getMisses() {
+    long long total = 0;
+    for (Shard& shard : shards) {
+        lock_guard<mutex> lock(shard.lock);
+        total += shard.misses;
+    }
+    return total;
+}
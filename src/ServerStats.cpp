@@ -0,0 +1,348 @@
+#include "../ServerStats.h"
+#include <sstream>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+
+using namespace std;
+namespace fs = filesystem;
+
+namespace {
+
+const char* PHASE_KEYS[REQUEST_PHASE_COUNT] = { "queue_us", "lock_us", "exec_us", "write_us" };
+const char* PHASE_LABELS[REQUEST_PHASE_COUNT] = { "queue_wait", "lock_wait", "execution", "serialization" };
+const double QUANTILES[] = { 0.5, 0.99, 0.999 };
+
+// Hands the calling thread's shard back to the stats when the thread exits.
+struct ShardHolder {
+    StatsShard* shard = nullptr;
+
+    ~ShardHolder() {
+        if (shard != nullptr) {
+            ServerStats::instance().retireShard(shard);
+        }
+    }
+};
+
+thread_local ShardHolder t_shard;
+
+void appendPercentiles(ostringstream& oss, const LatencyHistogram& histogram) {
+    oss << histogram.percentile(0.5) << "/" << histogram.percentile(0.99) << "/"
+        << histogram.percentile(0.999) << "/" << histogram.getMax();
+}
+
+void appendSummary(ostringstream& oss, const string& name, const string& labels,
+                   const LatencyHistogram& histogram) {
+    string separator = labels.empty() ? "" : ",";
+    string totals = labels.empty() ? "" : "{" + labels + "}";
+    for (double quantile : QUANTILES) {
+        oss << name << "{" << labels << separator << "quantile=\"" << quantile << "\"} "
+            << histogram.percentile(quantile) << "\n";
+    }
+    oss << name << "_sum" << totals << " " << (uint64_t)(histogram.getMean() * histogram.getCount()) << "\n";
+    oss << name << "_count" << totals << " " << histogram.getCount() << "\n";
+}
+
+}
+
+RequestStats::RequestStats() {
+    fill(begin(requests), end(requests), 0);
+    fill(begin(failures), end(failures), 0);
+    fill(begin(rejected), end(rejected), 0);
+    fill(begin(timedOut), end(timedOut), 0);
+    fill(begin(cancelled), end(cancelled), 0);
+}
+
+void RequestStats::record(RequestType type, const RequestTimings& timings, bool succeeded) {
+    int t = static_cast<int>(type);
+    requests[t]++;
+    if (!succeeded) {
+        failures[t]++;
+    }
+    for (int p = 0; p < REQUEST_PHASE_COUNT; p++) {
+        if (timings.phaseMicros[p] < 0) {
+            continue;
+        }
+        if (!phases[t][p]) {
+            phases[t][p].reset(new LatencyHistogram());
+        }
+        phases[t][p]->record((uint64_t)timings.phaseMicros[p]);
+    }
+    if (timings.nodesSettled >= 0) {
+        nodesSettled.record((uint64_t)timings.nodesSettled);
+    }
+}
+
+void RequestStats::merge(const RequestStats& other) {
+    for (int t = 0; t < REQUEST_TYPE_COUNT; t++) {
+        requests[t] += other.requests[t];
+        failures[t] += other.failures[t];
+        rejected[t] += other.rejected[t];
+        timedOut[t] += other.timedOut[t];
+        cancelled[t] += other.cancelled[t];
+        for (int p = 0; p < REQUEST_PHASE_COUNT; p++) {
+            if (!other.phases[t][p]) {
+                continue;
+            }
+            if (!phases[t][p]) {
+                phases[t][p].reset(new LatencyHistogram());
+            }
+            phases[t][p]->merge(*other.phases[t][p]);
+        }
+    }
+    nodesSettled.merge(other.nodesSettled);
+}
+
+ServerStats::ServerStats()
+    : activeConnections(0), totalConnections(0), startedAt(chrono::steady_clock::now()) {}
+
+ServerStats::~ServerStats() {
+    for (StatsShard* shard : shards) {
+        delete shard;
+    }
+}
+
+ServerStats& ServerStats::instance() {
+    static ServerStats stats;
+    return stats;
+}
+
+StatsShard* ServerStats::threadShard() {
+    if (t_shard.shard == nullptr) {
+        StatsShard* shard = new StatsShard();
+        lock_guard<mutex> lock(registryMutex);
+        shards.push_back(shard);
+        t_shard.shard = shard;
+    }
+    return t_shard.shard;
+}
+
+void ServerStats::recordRequest(RequestType type, const RequestTimings& timings, bool succeeded) {
+    StatsShard* shard = threadShard();
+    lock_guard<mutex> lock(shard->lock);
+    shard->stats.record(type, timings, succeeded);
+}
+
+void ServerStats::recordRejected(RequestType type) {
+    StatsShard* shard = threadShard();
+    lock_guard<mutex> lock(shard->lock);
+    shard->stats.rejected[static_cast<int>(type)]++;
+}
+
+void ServerStats::recordTimedOut(RequestType type) {
+    StatsShard* shard = threadShard();
+    lock_guard<mutex> lock(shard->lock);
+    shard->stats.timedOut[static_cast<int>(type)]++;
+}
+
+void ServerStats::recordCancelled(RequestType type) {
+    StatsShard* shard = threadShard();
+    lock_guard<mutex> lock(shard->lock);
+    shard->stats.cancelled[static_cast<int>(type)]++;
+}
+
+void ServerStats::connectionOpened() {
+    activeConnections++;
+    totalConnections++;
+}
+
+void ServerStats::connectionClosed() {
+    activeConnections--;
+}
+
+void ServerStats::retireShard(StatsShard* shard) {
+    lock_guard<mutex> lock(registryMutex);
+    shards.erase(remove(shards.begin(), shards.end(), shard), shards.end());
+    retired.merge(shard->stats);
+    delete shard;
+}
+
+void ServerStats::snapshot(RequestStats& out) {
+    lock_guard<mutex> lock(registryMutex);
+    out.merge(retired);
+    for (StatsShard* shard : shards) {
+        lock_guard<mutex> shardLock(shard->lock);
+        out.merge(shard->stats);
+    }
+}
+
+string ServerStats::formatSummary(const ServerGauges& gauges) {
+    RequestStats stats;
+    snapshot(stats);
+
+    uint64_t requests = 0, rejected = 0, timedOut = 0, cancelled = 0;
+    for (int t = 0; t < REQUEST_TYPE_COUNT; t++) {
+        requests += stats.requests[t];
+        rejected += stats.rejected[t];
+        timedOut += stats.timedOut[t];
+        cancelled += stats.cancelled[t];
+    }
+
+    ostringstream oss;
+    oss << "uptime_s=" << chrono::duration_cast<chrono::seconds>(chrono::steady_clock::now() - startedAt).count()
+        << ";connections=" << activeConnections.load()
+        << ";connections_total=" << totalConnections.load()
+        << ";queue_depth=" << gauges.queueDepth
+        << ";queue_capacity=" << gauges.queueCapacity
+        << ";requests=" << requests
+        << ";rejected=" << rejected
+        << ";timed_out=" << timedOut
+        << ";cancelled=" << cancelled;
+    for (int c = 0; c < REQUEST_CLASS_COUNT; c++) {
+        oss << ";queue_" << requestClassToString(static_cast<RequestClass>(c)) << "="
+            << gauges.classDepth[c] << "/" << gauges.classLimit[c] << "/" << gauges.classRunning[c];
+    }
+    long long lookups = gauges.routeCacheHits + gauges.routeCacheMisses;
+    oss << ";route_cache=" << gauges.routeCacheHits << "/" << gauges.routeCacheMisses
+        << "/" << gauges.routeCacheEntries << "/" << gauges.routeCacheBytes
+        << ";route_cache_hit_pct=" << (lookups ? gauges.routeCacheHits * 100 / lookups : 0)
+        << ";route_coalesced=" << gauges.routeCoalesced << "/" << gauges.routeCoalesceRefused;
+    if (stats.nodesSettled.getCount() > 0) {
+        oss << ";settled=";
+        appendPercentiles(oss, stats.nodesSettled);
+    }
+
+    // Per type: count/failed/rejected, then each phase that was measured.
+    for (int t = 0; t < REQUEST_TYPE_COUNT; t++) {
+        if (stats.requests[t] == 0 && stats.rejected[t] == 0) {
+            continue;
+        }
+        string name = requestTypeToString(static_cast<RequestType>(t));
+        oss << ";" << name << "=" << stats.requests[t] << "/" << stats.failures[t] << "/" << stats.rejected[t];
+        for (int p = 0; p < REQUEST_PHASE_COUNT; p++) {
+            const LatencyHistogram* histogram = stats.getPhase(t, static_cast<RequestPhase>(p));
+            if (histogram != nullptr) {
+                oss << ";" << name << "." << PHASE_KEYS[p] << "=";
+                appendPercentiles(oss, *histogram);
+            }
+        }
+    }
+    return oss.str();
+}
+
+string ServerStats::formatPrometheus(const ServerGauges& gauges) {
+    RequestStats stats;
+    snapshot(stats);
+
+    ostringstream oss;
+    oss << "# HELP maps_uptime_seconds Seconds since the server started.\n"
+        << "# TYPE maps_uptime_seconds gauge\n"
+        << "maps_uptime_seconds "
+        << chrono::duration_cast<chrono::seconds>(chrono::steady_clock::now() - startedAt).count() << "\n"
+        << "# HELP maps_active_connections Connected clients.\n"
+        << "# TYPE maps_active_connections gauge\n"
+        << "maps_active_connections " << activeConnections.load() << "\n"
+        << "# HELP maps_connections_total Clients accepted since start.\n"
+        << "# TYPE maps_connections_total counter\n"
+        << "maps_connections_total " << totalConnections.load() << "\n"
+        << "# HELP maps_queue_depth Requests waiting for a worker.\n"
+        << "# TYPE maps_queue_depth gauge\n"
+        << "maps_queue_depth " << gauges.queueDepth << "\n"
+        << "# HELP maps_queue_capacity Request queue capacity.\n"
+        << "# TYPE maps_queue_capacity gauge\n"
+        << "maps_queue_capacity " << gauges.queueCapacity << "\n";
+    oss << "# HELP maps_class_queue_depth Requests waiting for a worker, by scheduling class.\n"
+        << "# TYPE maps_class_queue_depth gauge\n";
+    for (int c = 0; c < REQUEST_CLASS_COUNT; c++) {
+        oss << "maps_class_queue_depth{class=\"" << requestClassToString(static_cast<RequestClass>(c)) << "\"} "
+            << gauges.classDepth[c] << "\n";
+    }
+    oss << "# HELP maps_class_queue_limit Current adaptive queue limit, by scheduling class.\n"
+        << "# TYPE maps_class_queue_limit gauge\n";
+    for (int c = 0; c < REQUEST_CLASS_COUNT; c++) {
+        oss << "maps_class_queue_limit{class=\"" << requestClassToString(static_cast<RequestClass>(c)) << "\"} "
+            << gauges.classLimit[c] << "\n";
+    }
+    oss << "# HELP maps_class_running Workers busy, by scheduling class.\n"
+        << "# TYPE maps_class_running gauge\n";
+    for (int c = 0; c < REQUEST_CLASS_COUNT; c++) {
+        oss << "maps_class_running{class=\"" << requestClassToString(static_cast<RequestClass>(c)) << "\"} "
+            << gauges.classRunning[c] << "\n";
+    }
+    oss << "# HELP maps_route_cache_hits_total Routes answered from the route cache.\n"
+        << "# TYPE maps_route_cache_hits_total counter\n"
+        << "maps_route_cache_hits_total " << gauges.routeCacheHits << "\n"
+        << "# HELP maps_route_cache_misses_total Routes that needed a search.\n"
+        << "# TYPE maps_route_cache_misses_total counter\n"
+        << "maps_route_cache_misses_total " << gauges.routeCacheMisses << "\n"
+        << "# HELP maps_route_cache_entries Routes held in the route cache.\n"
+        << "# TYPE maps_route_cache_entries gauge\n"
+        << "maps_route_cache_entries " << gauges.routeCacheEntries << "\n"
+        << "# HELP maps_route_cache_bytes Approximate route cache footprint.\n"
+        << "# TYPE maps_route_cache_bytes gauge\n"
+        << "maps_route_cache_bytes " << gauges.routeCacheBytes << "\n"
+        << "# HELP maps_route_coalesced_total Route requests answered by an identical search in flight.\n"
+        << "# TYPE maps_route_coalesced_total counter\n"
+        << "maps_route_coalesced_total " << gauges.routeCoalesced << "\n"
+        << "# HELP maps_route_coalesce_refused_total Route requests that found the flight's waiter list full.\n"
+        << "# TYPE maps_route_coalesce_refused_total counter\n"
+        << "maps_route_coalesce_refused_total " << gauges.routeCoalesceRefused << "\n";
+
+    oss << "# HELP maps_requests_total Requests processed, by type.\n"
+        << "# TYPE maps_requests_total counter\n";
+    for (int t = 0; t < REQUEST_TYPE_COUNT; t++) {
+        oss << "maps_requests_total{type=\"" << requestTypeToString(static_cast<RequestType>(t)) << "\"} "
+            << stats.requests[t] << "\n";
+    }
+    oss << "# HELP maps_request_failures_total Requests answered with an error, by type.\n"
+        << "# TYPE maps_request_failures_total counter\n";
+    for (int t = 0; t < REQUEST_TYPE_COUNT; t++) {
+        oss << "maps_request_failures_total{type=\"" << requestTypeToString(static_cast<RequestType>(t)) << "\"} "
+            << stats.failures[t] << "\n";
+    }
+    oss << "# HELP maps_requests_rejected_total Requests refused because the queue was full, by type.\n"
+        << "# TYPE maps_requests_rejected_total counter\n";
+    for (int t = 0; t < REQUEST_TYPE_COUNT; t++) {
+        oss << "maps_requests_rejected_total{type=\"" << requestTypeToString(static_cast<RequestType>(t)) << "\"} "
+            << stats.rejected[t] << "\n";
+    }
+
+    oss << "# HELP maps_requests_timed_out_total Requests answered with TIMEOUT because their deadline passed, by type.\n"
+        << "# TYPE maps_requests_timed_out_total counter\n";
+    for (int t = 0; t < REQUEST_TYPE_COUNT; t++) {
+        oss << "maps_requests_timed_out_total{type=\"" << requestTypeToString(static_cast<RequestType>(t)) << "\"} "
+            << stats.timedOut[t] << "\n";
+    }
+    oss << "# HELP maps_requests_cancelled_total Requests dropped because the client disconnected, by type.\n"
+        << "# TYPE maps_requests_cancelled_total counter\n";
+    for (int t = 0; t < REQUEST_TYPE_COUNT; t++) {
+        oss << "maps_requests_cancelled_total{type=\"" << requestTypeToString(static_cast<RequestType>(t)) << "\"} "
+            << stats.cancelled[t] << "\n";
+    }
+    
+    oss << "# HELP maps_request_phase_microseconds Time spent in each phase of a request.\n"
+        << "# TYPE maps_request_phase_microseconds summary\n";
+    for (int t = 0; t < REQUEST_TYPE_COUNT; t++) {
+        for (int p = 0; p < REQUEST_PHASE_COUNT; p++) {
+            const LatencyHistogram* histogram = stats.getPhase(t, static_cast<RequestPhase>(p));
+            if (histogram == nullptr) {
+                continue;
+            }
+            string labels = "type=\"" + requestTypeToString(static_cast<RequestType>(t)) +
+                            "\",phase=\"" + PHASE_LABELS[p] + "\"";
+            appendSummary(oss, "maps_request_phase_microseconds", labels, *histogram);
+        }
+    }
+
+    oss << "# HELP maps_route_nodes_settled Nodes settled by Dijkstra per FIND_PATH.\n"
+        << "# TYPE maps_route_nodes_settled summary\n";
+    appendSummary(oss, "maps_route_nodes_settled", "", stats.nodesSettled);
+    return oss.str();
+}
+
+bool ServerStats::writePrometheusFile(const string& path, const ServerGauges& gauges) {
+    string temporary = path + ".tmp";
+    {
+        ofstream file(temporary);
+        if (!file.is_open()) {
+            return false;
+        }
+        file << formatPrometheus(gauges);
+        if (!file.good()) {
+            return false;
+        }
+    }
+    error_code error;
+    fs::rename(temporary, path, error);
+    return !error;
+}
@@ -0,0 +1,893 @@
+#include "../BTree.h"
+#include "../ConcurrentBTree.h"
+#include "../Graph.h"
+#include "../Location.h"
+#include "../TrigramIndex.h"
+#include "../Navigation.h"
+#include "../AdjacencyCache.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <cmath>
+#include <filesystem>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+using namespace std;
+
+const int LOOKUPS_PER_RUN = 2000000;
+const unsigned BENCH_SEED = 42;
+const int CONCURRENT_OPS_PER_THREAD = 500000;
+const int CONCURRENT_WRITE_PERCENT = 10;
+const int MAX_BENCH_THREADS = 32;
+const int SUITE_DEFAULT_NODES = 100000;
+const int SUITE_DEFAULT_QUERIES = 200;
+const int SUITE_LOOKUPS = 1000000;
+const int LOCAL_QUERY_STEPS = 40;
+const double DEFAULT_REGRESSION_PERCENT = 10.0;
+
+// Every heap allocation in the process goes through these, so a benchmark
+// can report how many allocations and frees a phase performed.
+atomic<long long> g_heapAllocs(0);
+atomic<long long> g_heapFrees(0);
+
+void* operator new(size_t size) {
+    g_heapAllocs.fetch_add(1, memory_order_relaxed);
+    void* ptr = malloc(size ? size : 1);
+    if (ptr == nullptr) throw bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (ptr != nullptr) g_heapFrees.fetch_add(1, memory_order_relaxed);
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+struct AllocSnapshot {
+    long long allocs;
+    long long frees;
+    chrono::steady_clock::time_point time;
+
+    AllocSnapshot() : allocs(g_heapAllocs.load()), frees(g_heapFrees.load()),
+                      time(chrono::steady_clock::now()) {}
+};
+
+void printAllocPhase(const string& phase, const AllocSnapshot& before) {
+    AllocSnapshot after;
+    cout << "  " << left << setw(22) << phase << right
+         << " allocs=" << setw(9) << (after.allocs - before.allocs)
+         << " frees=" << setw(9) << (after.frees - before.frees)
+         << " time=" << fixed << setprecision(1)
+         << chrono::duration<double, milli>(after.time - before.time).count() << " ms" << endl;
+}
+
+template<int ORDER>
+void benchLookups(const vector<int>& keys, const vector<int>& queries) {
+    BTree<int, int, ORDER> tree;
+
+    auto start = chrono::steady_clock::now();
+    for (int key : keys) {
+        tree.insert(key, key);
+    }
+    auto built = chrono::steady_clock::now();
+
+    long long checksum = 0;
+    for (int key : queries) {
+        const int* value = tree.find(key);
+        if (value != nullptr) {
+            checksum += *value;
+        }
+    }
+    auto done = chrono::steady_clock::now();
+
+    double buildMs = chrono::duration<double, milli>(built - start).count();
+    double lookupNs = chrono::duration<double, nano>(done - built).count() / queries.size();
+
+    cout << "  order=" << setw(3) << ORDER
+         << "  keys/node=" << setw(3) << BTreeNode<int, int, ORDER>::MAX_KEYS
+         << "  height=" << tree.getHeight()
+         << "  build=" << fixed << setprecision(1) << buildMs << " ms"
+         << "  lookup=" << setprecision(1) << lookupNs << " ns"
+         << "  (checksum " << checksum << ")" << endl;
+}
+
+void runLookupBenchmark(int keyCount) {
+    mt19937 rng(BENCH_SEED);
+
+    vector<int> keys(keyCount);
+    for (int i = 0; i < keyCount; i++) {
+        keys[i] = i + 1;
+    }
+    shuffle(keys.begin(), keys.end(), rng);
+
+    uniform_int_distribution<int> pick(1, keyCount);
+    vector<int> queries(LOOKUPS_PER_RUN);
+    for (int& q : queries) {
+        q = pick(rng);
+    }
+
+    cout << "\nB-tree lookup, " << keyCount << " keys, "
+         << LOOKUPS_PER_RUN << " random lookups" << endl;
+    benchLookups<3>(keys, queries);
+    benchLookups<16>(keys, queries);
+    benchLookups<32>(keys, queries);
+    benchLookups<64>(keys, queries);
+}
+
+// Each thread issues a fixed number of operations: mostly lookups of
+// random existing keys, plus inserts of keys no other thread touches.
+template<typename Insert, typename Lookup>
+double runMixedWorkload(int threads, int prefill, Insert insert, Lookup lookup) {
+    atomic<bool> go(false);
+    atomic<long long> hits(0);
+    vector<thread> workers;
+
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            mt19937 rng(BENCH_SEED + t);
+            uniform_int_distribution<int> pick(1, prefill);
+            uniform_int_distribution<int> percent(0, 99);
+            int nextKey = prefill + 1 + t;
+            long long found = 0;
+
+            while (!go.load()) {
+                this_thread::yield();
+            }
+            for (int i = 0; i < CONCURRENT_OPS_PER_THREAD; i++) {
+                if (percent(rng) < CONCURRENT_WRITE_PERCENT) {
+                    insert(nextKey);
+                    nextKey += MAX_BENCH_THREADS;
+                } else {
+                    found += lookup(pick(rng)) ? 1 : 0;
+                }
+            }
+            hits += found;
+        });
+    }
+
+    auto start = chrono::steady_clock::now();
+    go.store(true);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return (double)threads * CONCURRENT_OPS_PER_THREAD / seconds / 1e6;
+}
+
+void runConcurrentBenchmark(int prefill) {
+    cout << "\nMixed workload, " << prefill << " keys preloaded, "
+         << (100 - CONCURRENT_WRITE_PERCENT) << "% lookups / "
+         << CONCURRENT_WRITE_PERCENT << "% inserts, "
+         << CONCURRENT_OPS_PER_THREAD << " ops per thread" << endl;
+    cout << "  (hardware threads: " << thread::hardware_concurrency() << ")" << endl;
+
+    for (int threads = 1; threads <= MAX_BENCH_THREADS; threads *= 2) {
+        BTree<int, int> lockedTree;
+        mutex treeMutex;
+        ConcurrentBTree<int, int> concurrentTree;
+        for (int key = 1; key <= prefill; key++) {
+            lockedTree.insert(key, key);
+            concurrentTree.insert(key, key);
+        }
+
+        double locked = runMixedWorkload(threads, prefill,
+            [&](int key) {
+                lock_guard<mutex> lock(treeMutex);
+                lockedTree.insert(key, key);
+            },
+            [&](int key) {
+                lock_guard<mutex> lock(treeMutex);
+                return lockedTree.find(key) != nullptr;
+            });
+
+        double optimistic = runMixedWorkload(threads, prefill,
+            [&](int key) { concurrentTree.insert(key, key); },
+            [&](int key) {
+                int value;
+                return concurrentTree.lookup(key, value);
+            });
+
+        cout << "  threads=" << setw(2) << threads
+             << "  BTree+mutex=" << fixed << setprecision(2) << setw(7) << locked << " Mops/s"
+             << "  ConcurrentBTree=" << setw(7) << optimistic << " Mops/s"
+             << "  speedup=" << setprecision(2) << (optimistic / locked) << "x" << endl;
+    }
+}
+
+void runAllocBenchmark(int count) {
+    vector<Location> locations;
+    locations.reserve(count);
+    for (int i = 1; i <= count; i++) {
+        locations.emplace_back(i, "Loc " + to_string(i % 100000), 40.0 + (i % 1000) * 0.001,
+                               -74.0 + (i / 1000 % 1000) * 0.001, "node");
+    }
+
+    cout << "\nAllocation counts, " << count << " locations, "
+         << 2 * count << " roads (names fit the small-string buffer)" << endl;
+
+    {
+        BTree<int, Location> tree;
+        AllocSnapshot build;
+        for (const Location& loc : locations) {
+            tree.insert(loc.id, loc);
+        }
+        printAllocPhase("BTree build", build);
+        cout << "    arena chunks=" << tree.getArena().getChunkCount()
+             << " used=" << tree.getArena().getBytesUsed() / 1024 << " KB"
+             << " reserved=" << tree.getArena().getBytesReserved() / 1024 << " KB" << endl;
+
+        AllocSnapshot teardown;
+        tree.clear();
+        printAllocPhase("BTree clear", teardown);
+    }
+
+    {
+        Graph graph;
+        AllocSnapshot build;
+        for (const Location& loc : locations) {
+            graph.addNode(loc);
+        }
+        for (int i = 1; i <= count; i++) {
+            graph.addEdge(i, i % count + 1, 1.0, true);
+            graph.addEdge(i, (i * 7) % count + 1, 2.0, false);
+        }
+        printAllocPhase("Graph build", build);
+        cout << "    arena chunks=" << graph.getArena().getChunkCount()
+             << " used=" << graph.getArena().getBytesUsed() / 1024 << " KB"
+             << " reserved=" << graph.getArena().getBytesReserved() / 1024 << " KB" << endl;
+
+        AllocSnapshot teardown;
+        graph.clear();
+        printAllocPhase("Graph clear", teardown);
+    }
+}
+
+// Half the queries hit, half miss. Misses are the case the filters are for:
+// they are answered without descending the tree.
+template<int ORDER>
+void benchFilterMode(const string& label, KeyFilterMode mode,
+                     const vector<int>& keys, const vector<int>& queries) {
+    BTree<int, int, ORDER> tree;
+    tree.setFilterMode(mode);
+    for (int key : keys) {
+        tree.insert(key, key);
+    }
+
+    auto start = chrono::steady_clock::now();
+    long long hits = 0;
+    for (int key : queries) {
+        hits += tree.exists(key) ? 1 : 0;
+    }
+    double lookupNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count()
+                      / queries.size();
+
+    cout << "  " << left << setw(13) << label << right
+         << "  exists=" << fixed << setprecision(1) << setw(6) << lookupNs << " ns"
+         << "  filter=" << setw(7) << tree.getFilter().getMemoryBytes() / 1024 << " KB"
+         << "  (hits " << hits << ")" << endl;
+}
+
+// A dense bitmap that once left a far-off key out must keep answering
+// "maybe" for it after later keys grow the bitmap past it. Returns false,
+// with the reason printed, if the key is lost or inserted twice.
+bool checkBitmapOverflow() {
+    BTree<int, int, 32> tree;
+    tree.setFilterMode(KeyFilterMode::DENSE_BITMAP);
+    tree.insert(2000000, 0);
+    for (int key = 1; key <= 200000; key++) {
+        tree.insert(key, key);
+    }
+    tree.insert(1500000, 0);
+
+    bool ok = true;
+    if (tree.find(2000000) == nullptr) {
+        cout << "FAILED: dense bitmap lost key 2000000 after growing" << endl;
+        ok = false;
+    }
+    int count = tree.getCount();
+    tree.insert(2000000, 1);
+    if (tree.getCount() != count) {
+        cout << "FAILED: key 2000000 inserted twice (" << count << " -> "
+             << tree.getCount() << " keys)" << endl;
+        ok = false;
+    }
+    return ok;
+}
+
+void runFilterBenchmark(int keyCount) {
+    mt19937 rng(BENCH_SEED);
+
+    vector<int> keys(keyCount);
+    for (int i = 0; i < keyCount; i++) {
+        keys[i] = i + 1;
+    }
+    shuffle(keys.begin(), keys.end(), rng);
+
+    uniform_int_distribution<int> hit(1, keyCount);
+    uniform_int_distribution<int> miss(keyCount + 1, 2 * keyCount);
+    vector<int> queries(LOOKUPS_PER_RUN);
+    for (size_t i = 0; i < queries.size(); i++) {
+        queries[i] = (i & 1) ? miss(rng) : hit(rng);
+    }
+
+    cout << "\nExistence checks, " << keyCount << " keys, "
+         << LOOKUPS_PER_RUN << " lookups (50% misses)" << endl;
+    benchFilterMode<32>("none", KeyFilterMode::NONE, keys, queries);
+    benchFilterMode<32>("bloom", KeyFilterMode::BLOOM, keys, queries);
+    benchFilterMode<32>("dense bitmap", KeyFilterMode::DENSE_BITMAP, keys, queries);
+}
+
+// Two words of two or three random consonant-vowel syllables, e.g.
+// "Kalomi Trevan".
+string makePlaceName(mt19937& rng) {
+    static const char* onsets[] = {
+        "b", "c", "d", "f", "g", "h", "j", "k", "l", "m", "n", "p", "r", "s", "t",
+        "v", "w", "z", "br", "ch", "dr", "gr", "kl", "pr", "sh", "st", "th", "tr"
+    };
+    static const char* vowels[] = {"a", "e", "i", "o", "u", "y", "ai", "ea", "ou"};
+    static const char* codas[] = {"", "", "", "n", "r", "l", "s", "m", "th", "nd"};
+    uniform_int_distribution<int> onset(0, 27);
+    uniform_int_distribution<int> vowel(0, 8);
+    uniform_int_distribution<int> coda(0, 9);
+    uniform_int_distribution<int> length(2, 3);
+
+    string name;
+    for (int word = 0; word < 2; word++) {
+        if (word > 0) name += ' ';
+        size_t start = name.size();
+        int parts = length(rng);
+        for (int i = 0; i < parts; i++) {
+            name += onsets[onset(rng)];
+            name += vowels[vowel(rng)];
+            name += codas[coda(rng)];
+        }
+        name[start] = (char)toupper((unsigned char)name[start]);
+    }
+    return name;
+}
+
+// Replaces one character of each query so the lookup has to tolerate a typo.
+void runFuzzyBenchmark(int count) {
+    mt19937 rng(BENCH_SEED);
+    vector<string> names(count + 1);
+    TrigramIndex index;
+
+    auto start = chrono::steady_clock::now();
+    for (int id = 1; id <= count; id++) {
+        names[id] = makePlaceName(rng);
+        index.add(id, names[id]);
+    }
+    double buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    const int queryCount = 2000;
+    uniform_int_distribution<int> pickId(1, count);
+    vector<string> queries;
+    for (int i = 0; i < queryCount; i++) {
+        string query = names[pickId(rng)];
+        query[rng() % query.size()] = 'x';
+        queries.push_back(query);
+    }
+
+    auto nameOf = [&](int id) -> const string* {
+        return (id > 0 && id <= count) ? &names[id] : nullptr;
+    };
+
+    long long found = 0;
+    start = chrono::steady_clock::now();
+    for (const string& query : queries) {
+        found += index.search(query, 2, 10, nameOf).size();
+    }
+    double queryUs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / queryCount;
+
+    cout << "\nFuzzy search, " << count << " names, " << queryCount << " queries with one typo" << endl;
+    cout << "  build=" << fixed << setprecision(1) << buildMs << " ms"
+         << "  index=" << index.getMemoryBytes() / 1024 << " KB"
+         << " (" << setprecision(1) << (double)index.getMemoryBytes() / count << " bytes/name)" << endl;
+    cout << "  top-10 query=" << setprecision(1) << queryUs << " us"
+         << "  avg results=" << setprecision(2) << (double)found / queryCount << endl;
+}
+
+long long peakRssKb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return (long long)(counters.PeakWorkingSetSize / 1024);
+    }
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+// One measured phase of the suite. Per-operation latencies are kept for
+// the percentiles; whole-file phases record a single operation covering
+// `items` records.
+struct SuiteResult {
+    string name;
+    long long ops;
+    long long items;
+    double seconds;
+    vector<double> latenciesUs;
+    double settledAvg;
+    long long peakRss;
+
+    SuiteResult(const string& n) : name(n), ops(0), items(0), seconds(0.0), settledAvg(-1.0), peakRss(0) {}
+
+    double percentile(double p) const {
+        if (latenciesUs.empty()) return seconds * 1e6;
+        vector<double> sorted(latenciesUs);
+        size_t index = min(sorted.size() - 1, (size_t)(p * sorted.size()));
+        nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+        return sorted[index];
+    }
+
+    double throughput() const { return seconds > 0 ? (double)items / seconds : 0.0; }
+};
+
+class SuiteTimer {
+private:
+    SuiteResult& result;
+    chrono::steady_clock::time_point start;
+
+public:
+    explicit SuiteTimer(SuiteResult& r) : result(r), start(chrono::steady_clock::now()) {}
+
+    // Times one operation of the phase.
+    template<typename Op>
+    void measure(Op op) {
+        auto before = chrono::steady_clock::now();
+        op();
+        result.latenciesUs.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - before).count());
+        result.ops++;
+        result.items++;
+    }
+
+    void finish(long long items = -1) {
+        result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (items >= 0) {
+            result.ops = max(result.ops, 1LL);
+            result.items = items;
+        }
+        result.peakRss = peakRssKb();
+    }
+};
+
+// Perturbed square grid, like `generator grid`: each intersection joins
+// its east and north neighbour, and a road is the haversine distance
+// between its ends times a 1.05-1.35 detour.
+void makeGridMap(int count, unsigned seed, vector<Location>& locations, vector<Edge>& edges) {
+    mt19937 rng(seed);
+    uniform_real_distribution<double> jitter(-0.3, 0.3);
+    uniform_real_distribution<double> detour(1.05, 1.35);
+    int columns = (int)ceil(sqrt((double)count));
+    const double step = 0.0009;
+
+    locations.clear();
+    edges.clear();
+    for (int i = 0; i < count; i++) {
+        locations.emplace_back(i + 1, "Street " + to_string(i / columns + 1) + " & Avenue " + to_string(i % columns + 1),
+                               40.0 + (i / columns + jitter(rng)) * step,
+                               -74.0 + (i % columns + jitter(rng)) * step * 1.3, "intersection");
+    }
+
+    auto addRoad = [&](int from, int to) {
+        const Location& a = locations[from];
+        const Location& b = locations[to];
+        double distance = Navigation::haversineDistance(a.latitude, a.longitude, b.latitude, b.longitude);
+        edges.emplace_back((int)edges.size() + 1, from + 1, to + 1, distance * detour(rng), "", true);
+    };
+    for (int i = 0; i < count; i++) {
+        if ((i + 1) % columns != 0 && i + 1 < count) addRoad(i, i + 1);
+        if (i + columns < count) addRoad(i, i + columns);
+    }
+}
+
+bool loadMap(const string& dir, vector<Location>& locations, vector<Edge>& edges) {
+    BTree<int, Location> locationTree;
+    BTree<int, Edge> edgeTree;
+    if (!locationTree.loadFromFile(dir + "/locations_btree.dat") ||
+        !edgeTree.loadFromFile(dir + "/edges_btree.dat")) {
+        return false;
+    }
+    for (auto it = locationTree.begin(); it.valid(); it.next()) locations.push_back(it.value());
+    for (auto it = edgeTree.begin(); it.valid(); it.next()) edges.push_back(it.value());
+    return !locations.empty();
+}
+
+// Random pairs stress whole-map searches; local pairs, found by a short
+// random walk from the source, are the typical short-trip query.
+void makeQueries(const Graph& graph, const vector<Location>& locations, int count, unsigned seed,
+                 vector<pair<int, int>>& randomPairs, vector<pair<int, int>>& localPairs) {
+    mt19937 rng(seed);
+    uniform_int_distribution<size_t> pick(0, locations.size() - 1);
+    for (int i = 0; i < count; i++) {
+        randomPairs.push_back({locations[pick(rng)].id, locations[pick(rng)].id});
+
+        int source = locations[pick(rng)].id;
+        int current = source;
+        for (int step = 0; step < LOCAL_QUERY_STEPS; step++) {
+            vector<Neighbor> next = graph.getNeighbors(current);
+            if (next.empty()) break;
+            current = next[rng() % next.size()].nodeId;
+        }
+        localPairs.push_back({source, current});
+    }
+}
+
+SuiteResult benchRoutes(const string& name, Graph& graph, AdjacencyCache* cache,
+                        const vector<pair<int, int>>& pairs, vector<double>& distances) {
+    SuiteResult result(name);
+    Navigation navigation(&graph, cache);
+    long long settled = 0;
+    bool reference = distances.empty();
+
+    SuiteTimer timer(result);
+    for (size_t i = 0; i < pairs.size(); i++) {
+        PathResult path;
+        timer.measure([&] { path = navigation.dijkstra(pairs[i].first, pairs[i].second); });
+        settled += path.nodesSettled;
+        if (reference) {
+            distances.push_back(path.totalDistance);
+        } else if (fabs(distances[i] - path.totalDistance) > 1e-9) {
+            cerr << "  warning: " << name << " disagrees on query " << i << endl;
+        }
+    }
+    timer.finish();
+    result.settledAvg = pairs.empty() ? 0.0 : (double)settled / pairs.size();
+    return result;
+}
+
+string jsonEscape(const string& text) {
+    string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+void writeSuiteJson(ostream& out, const map<string, string>& info, const vector<SuiteResult>& results) {
+    out << "{\n";
+    for (const auto& [key, value] : info) {
+        out << "  \"" << key << "\": " << value << ",\n";
+    }
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const SuiteResult& r = results[i];
+        out << "    {\"name\": \"" << jsonEscape(r.name) << "\""
+            << ", \"ops\": " << r.ops
+            << ", \"items\": " << r.items
+            << fixed << setprecision(3)
+            << ", \"seconds\": " << r.seconds
+            << ", \"per_second\": " << r.throughput()
+            << ", \"p50_us\": " << r.percentile(0.50)
+            << ", \"p99_us\": " << r.percentile(0.99);
+        if (r.settledAvg >= 0) {
+            out << ", \"settled_avg\": " << r.settledAvg;
+        }
+        out << ", \"peak_rss_kb\": " << r.peakRss << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+void printSuiteResult(const SuiteResult& r) {
+    cout << "  " << left << setw(20) << r.name << right
+         << fixed << setprecision(1)
+         << " " << setw(12) << r.throughput() << " /s"
+         << "  p50=" << setw(9) << setprecision(2) << r.percentile(0.50) << " us"
+         << "  p99=" << setw(9) << r.percentile(0.99) << " us";
+    if (r.settledAvg >= 0) {
+        cout << "  settled=" << setprecision(0) << r.settledAvg;
+    }
+    cout << "  rss=" << r.peakRss / 1024 << " MB" << endl;
+}
+
+int runSuite(int nodes, int queries, unsigned seed, const string& mapDir, const string& jsonFile) {
+    vector<Location> locations;
+    vector<Edge> edges;
+    if (mapDir.empty()) {
+        makeGridMap(nodes, seed, locations, edges);
+    } else if (!loadMap(mapDir, locations, edges)) {
+        cerr << "Cannot load map from " << mapDir << endl;
+        return 1;
+    }
+
+    cout << "\nRouting suite, " << locations.size() << " locations, " << edges.size() << " roads, "
+         << queries << " queries per set" << endl;
+    vector<SuiteResult> results;
+
+    // B-tree over the map's locations, inserted in random order.
+    vector<Location> shuffled(locations);
+    mt19937 rng(seed);
+    shuffle(shuffled.begin(), shuffled.end(), rng);
+    {
+        BTree<int, Location> tree;
+        results.emplace_back("btree_insert");
+        SuiteTimer insert(results.back());
+        for (const Location& loc : shuffled) {
+            insert.measure([&] { tree.insert(loc.id, loc); });
+        }
+        insert.finish();
+
+        uniform_int_distribution<size_t> pick(0, locations.size() - 1);
+        vector<int> lookups(SUITE_LOOKUPS);
+        for (int& id : lookups) id = locations[pick(rng)].id;
+        long long found = 0;
+        results.emplace_back("btree_search");
+        SuiteTimer search(results.back());
+        for (int id : lookups) {
+            search.measure([&] { found += tree.find(id) != nullptr; });
+        }
+        search.finish();
+        if (found != (long long)lookups.size()) {
+            cerr << "  warning: " << lookups.size() - found << " lookups missed" << endl;
+        }
+
+        string file = (filesystem::temp_directory_path() / "benchmark_suite_btree.dat").string();
+        results.emplace_back("btree_save");
+        SuiteTimer save(results.back());
+        tree.saveToFile(file);
+        save.finish(tree.getCount());
+
+        BTree<int, Location> loaded;
+        results.emplace_back("btree_load");
+        SuiteTimer load(results.back());
+        loaded.loadFromFile(file);
+        load.finish(loaded.getCount());
+        filesystem::remove(file);
+    }
+
+    Graph graph;
+    results.emplace_back("graph_build");
+    SuiteTimer build(results.back());
+    graph.build(locations, edges);
+    build.finish((long long)locations.size() + edges.size());
+
+    vector<pair<int, int>> randomPairs, localPairs;
+    makeQueries(graph, locations, queries, seed, randomPairs, localPairs);
+
+    // The cached engine must return the same distances as the direct one.
+    AdjacencyCache cache([&graph](int nodeId, vector<Neighbor>& out) {
+        out = graph.getNeighbors(nodeId);
+    });
+    vector<double> randomDistances, localDistances;
+    results.push_back(benchRoutes("dijkstra_random", graph, nullptr, randomPairs, randomDistances));
+    results.push_back(benchRoutes("dijkstra_local", graph, nullptr, localPairs, localDistances));
+    results.push_back(benchRoutes("cached_random", graph, &cache, randomPairs, randomDistances));
+    results.push_back(benchRoutes("cached_local", graph, &cache, localPairs, localDistances));
+
+    for (const SuiteResult& r : results) {
+        printSuiteResult(r);
+    }
+
+    if (!jsonFile.empty()) {
+        map<string, string> info = {
+            {"suite", "\"routing\""},
+            {"map", "\"" + jsonEscape(mapDir.empty() ? "grid" : mapDir) + "\""},
+            {"locations", to_string(locations.size())},
+            {"roads", to_string(edges.size())},
+            {"queries", to_string(queries)},
+            {"seed", to_string(seed)},
+            {"peak_rss_kb", to_string(peakRssKb())}
+        };
+        ofstream out(jsonFile);
+        writeSuiteJson(out, info, results);
+        if (!out) {
+            cerr << "Cannot write " << jsonFile << endl;
+            return 1;
+        }
+        cout << "  results written to " << jsonFile << endl;
+    }
+    return 0;
+}
+
+// Reads the "results" array of a suite JSON file into name -> field ->
+// value. Only understands the flat objects writeSuiteJson produces.
+bool readSuiteJson(const string& path, map<string, map<string, double>>& results, vector<string>& order) {
+    ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    stringstream buffer;
+    buffer << file.rdbuf();
+    string text = buffer.str();
+
+    size_t pos = text.find("\"results\"");
+    if (pos == string::npos) {
+        return false;
+    }
+    while ((pos = text.find('{', pos)) != string::npos) {
+        size_t end = text.find('}', pos);
+        if (end == string::npos) break;
+        string object = text.substr(pos + 1, end - pos - 1);
+        pos = end + 1;
+
+        string name;
+        map<string, double> fields;
+        stringstream parts(object);
+        string part;
+        while (getline(parts, part, ',')) {
+            size_t colon = part.find(':');
+            if (colon == string::npos) continue;
+            string key = part.substr(0, colon);
+            string value = part.substr(colon + 1);
+            key = key.substr(key.find('"') + 1);
+            key = key.substr(0, key.find('"'));
+            size_t quote = value.find('"');
+            if (quote != string::npos) {
+                if (key == "name") name = value.substr(quote + 1, value.rfind('"') - quote - 1);
+            } else {
+                fields[key] = atof(value.c_str());
+            }
+        }
+        if (!name.empty()) {
+            results[name] = fields;
+            order.push_back(name);
+        }
+    }
+    return !order.empty();
+}
+
+// Prints each metric of the new run against the base run. Throughput that
+// drops or latency and memory that grow by more than the threshold count
+// as regressions; a change in settled nodes means the search itself
+// changed. Returns 1 when anything regressed, for use in scripts.
+int runCompare(const string& basePath, const string& newPath, double thresholdPercent) {
+    map<string, map<string, double>> base, current;
+    vector<string> baseOrder, currentOrder;
+    if (!readSuiteJson(basePath, base, baseOrder) || !readSuiteJson(newPath, current, currentOrder)) {
+        cerr << "Cannot read suite results from " << basePath << " or " << newPath << endl;
+        return 2;
+    }
+
+    struct Metric {
+        const char* key;
+        bool higherIsBetter;
+    };
+    const Metric metrics[] = {
+        {"per_second", true}, {"p50_us", false}, {"p99_us", false},
+        {"settled_avg", false}, {"peak_rss_kb", false}
+    };
+
+    cout << "\nComparing " << newPath << " against " << basePath
+         << " (threshold " << thresholdPercent << "%)" << endl;
+    int regressions = 0;
+    for (const string& name : baseOrder) {
+        auto found = current.find(name);
+        if (found == current.end()) {
+            cout << "  " << left << setw(20) << name << right << " missing from new run" << endl;
+            regressions++;
+            continue;
+        }
+        for (const Metric& metric : metrics) {
+            auto before = base[name].find(metric.key);
+            auto after = found->second.find(metric.key);
+            if (before == base[name].end() || after == found->second.end() || before->second == 0) {
+                continue;
+            }
+            double change = (after->second - before->second) / before->second * 100.0;
+            bool worse = metric.higherIsBetter ? change < -thresholdPercent : change > thresholdPercent;
+            bool searchChanged = string(metric.key) == "settled_avg" && fabs(change) > 0.01;
+
+            cout << "  " << left << setw(20) << name << setw(12) << metric.key << right
+                 << fixed << setprecision(2) << setw(14) << before->second
+                 << setw(14) << after->second
+                 << setw(9) << showpos << setprecision(1) << change << "%" << noshowpos
+                 << (worse ? "  REGRESSION" : searchChanged ? "  changed" : "") << endl;
+            if (worse) regressions++;
+        }
+    }
+    cout << "  " << regressions << " regression(s)" << endl;
+    return regressions > 0 ? 1 : 0;
+}
+
+void printUsage() {
+    cout << "Usage:" << endl;
+    cout << "  benchmark lookup [keyCount ...]     B-tree lookup latency (default 1M and 10M keys)" << endl;
+    cout << "  benchmark concurrent [keyCount]     mixed read/write scaling, 1 to 32 threads" << endl;
+    cout << "  benchmark alloc [count]             heap allocations for tree and graph build/teardown" << endl;
+    cout << "  benchmark filter [keyCount]         existence checks with and without a key filter" << endl;
+    cout << "  benchmark fuzzy [count]             trigram index size and typo-tolerant search latency" << endl;
+    cout << "  benchmark suite [nodes] [--queries N] [--seed S] [--map DIR] [--json FILE]" << endl;
+    cout << "                                      B-tree, graph build and routing on a generated map" << endl;
+    cout << "  benchmark compare BASE.json NEW.json [thresholdPercent]" << endl;
+    cout << "                                      diff two suite runs; exits 1 on a regression" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    string mode = argc > 1 ? argv[1] : "lookup";
+
+    if (mode == "compare") {
+        if (argc < 4) {
+            printUsage();
+            return 2;
+        }
+        return runCompare(argv[2], argv[3], argc > 4 ? atof(argv[4]) : DEFAULT_REGRESSION_PERCENT);
+    }
+
+    vector<int> sizes;
+    int queries = SUITE_DEFAULT_QUERIES;
+    unsigned seed = BENCH_SEED;
+    string mapDir, jsonFile;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--", 0) == 0 && i + 1 < argc) {
+            string value = argv[++i];
+            if (arg == "--queries") queries = stoi(value);
+            else if (arg == "--seed") seed = (unsigned)stoul(value);
+            else if (arg == "--map") mapDir = value;
+            else if (arg == "--json") jsonFile = value;
+            else {
+                printUsage();
+                return 1;
+            }
+        } else {
+            sizes.push_back(stoi(arg));
+        }
+    }
+
+#if defined(__AVX2__)
+    cout << "Key search: AVX2" << endl;
+#elif defined(__SSE2__)
+    cout << "Key search: SSE2" << endl;
+#else
+    cout << "Key search: scalar" << endl;
+#endif
+
+    if (mode == "lookup") {
+        if (sizes.empty()) {
+            sizes = {1000000, 10000000};
+        }
+        for (int size : sizes) {
+            runLookupBenchmark(size);
+        }
+    } else if (mode == "concurrent") {
+        runConcurrentBenchmark(sizes.empty() ? 1000000 : sizes[0]);
+    } else if (mode == "alloc") {
+        runAllocBenchmark(sizes.empty() ? 1000000 : sizes[0]);
+    } else if (mode == "filter") {
+        if (!checkBitmapOverflow()) {
+            return 1;
+        }
+        runFilterBenchmark(sizes.empty() ? 1000000 : sizes[0]);
+    } else if (mode == "fuzzy") {
+        runFuzzyBenchmark(sizes.empty() ? 1000000 : sizes[0]);
+    } else if (mode == "suite") {
+        return runSuite(sizes.empty() ? SUITE_DEFAULT_NODES : sizes[0], queries, seed, mapDir, jsonFile);
+    } else {
+        printUsage();
+        return 1;
+    }
+
+    return 0;
+}
@@ -15,11 +15,16 @@
 #endif
 
 #include "../Request.h"
+#include "../ImportBatch.h"
 
 #include <iostream>
 #include <string>
 #include <sstream>
+#include <fstream>
+#include <cstring>
 #include <limits>
+#include <algorithm>
+#include <iomanip>
 #include <thread>
 #include <atomic>
 
@@ -28,6 +33,7 @@ using namespace std;
 const char* SERVER_HOST = "127.0.0.1";
 const int SERVER_PORT = 8080;
 const int BUFFER_SIZE = 4096;
+const size_t IMPORT_CHUNK_SIZE = 64 * 1024;
 
 atomic<bool> g_connected(false);
 atomic<int> g_clientId(0);
@@ -49,9 +55,11 @@ void displayMenu() {
     cout << "5. View all roads" << endl;
     cout << "6. Initialize sample data" << endl;
     cout << "7. Save data" << endl;
-    cout << "8. Disconnect and exit" << endl;
+    cout << "8. Search locations by name" << endl;
+    cout << "9. Server statistics" << endl;
+    cout << "10. Disconnect and exit" << endl;
     cout << "========================================" << endl;
-    cout << "Enter your choice (1-8): ";
+    cout << "Enter your choice (1-10): ";
 }
 
 bool sendRequest(SOCKET sock, const Request& req) {
@@ -60,25 +68,37 @@ bool sendRequest(SOCKET sock, const Request& req) {
     return result != SOCKET_ERROR;
 }
 
+bool sendAll(SOCKET sock, const string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        int result = send(sock, data.c_str() + sent, (int)(data.size() - sent), 0);
+        if (result == SOCKET_ERROR || result == 0) {
+            return false;
+        }
+        sent += result;
+    }
+    return true;
+}
+
+// Bytes past the end of the line just returned; a streamed listing can
+// deliver several responses in one recv.
+string g_received;
+
 Response receiveResponse(SOCKET sock) {
     char buffer[BUFFER_SIZE];
-    memset(buffer, 0, BUFFER_SIZE);
     
-    string data;
-    while (true) {
-        int bytesReceived = recv(sock, buffer, BUFFER_SIZE - 1, 0);
+    size_t end;
+    while ((end = g_received.find('\n')) == string::npos) {
+        int bytesReceived = recv(sock, buffer, BUFFER_SIZE, 0);
         if (bytesReceived <= 0) {
+            end = g_received.size();
             break;
         }
-        data += string(buffer, bytesReceived);
-        if (data.find('\n') != string::npos) {
-            break;
-        }
+        g_received.append(buffer, bytesReceived);
     }
     
-    if (!data.empty() && data.back() == '\n') {
-        data.pop_back();
-    }
+    string data = g_received.substr(0, end);
+    g_received.erase(0, min(end + 1, g_received.size()));
     
     return Response::deserialize(data);
 }
@@ -90,6 +110,8 @@ void displayResponse(const Response& resp) {
         if (!resp.data.empty()) {
             cout << "Data: " << resp.data << endl;
         }
+    } else if (resp.status == ResponseStatus::TIMEOUT) {
+        cout << "[TIMEOUT] " << resp.message << endl;
     } else {
         cout << "[ERROR] " << resp.message << endl;
     }
@@ -189,18 +211,41 @@ void handleFindPath(SOCKET sock) {
     }
 }
 
-void handleViewLocations(SOCKET sock) {
-    Request req(g_clientId, g_requestId++, RequestType::GET_LOCATIONS);
+// Asks for the whole table as a stream of pages and shows each page as it
+// arrives; the page without next= is the last one.
+void handleViewTable(SOCKET sock, RequestType type) {
+    Request req(g_clientId, g_requestId++, type);
+    req.setParam("stream", true);
     
-    if (sendRequest(sock, req)) {
-        displayResponse(receiveResponse(sock));
-    } else {
+    if (!sendRequest(sock, req)) {
         cout << "Failed to send request" << endl;
+        return;
+    }
+    
+    while (true) {
+        Response resp = receiveResponse(sock);
+        displayResponse(resp);
+        if (resp.status != ResponseStatus::SUCCESS || resp.data.find(";next=") == string::npos) {
+            break;
+        }
     }
 }
 
-void handleViewRoads(SOCKET sock) {
-    Request req(g_clientId, g_requestId++, RequestType::GET_ROADS);
+void handleViewLocations(SOCKET sock) {
+    handleViewTable(sock, RequestType::GET_LOCATIONS);
+}
+
+void handleSearchLocations(SOCKET sock) {
+    cout << "\n--- Search Locations ---" << endl;
+    
+    string prefix;
+    
+    cout << "Enter name prefix: ";
+    clearInput();
+    getline(cin, prefix);
+    
+    Request req(g_clientId, g_requestId++, RequestType::SEARCH_LOCATION);
+    req.setParam("prefix", prefix);
     
     if (sendRequest(sock, req)) {
         displayResponse(receiveResponse(sock));
@@ -209,6 +254,10 @@ void handleViewRoads(SOCKET sock) {
     }
 }
 
+void handleViewRoads(SOCKET sock) {
+    handleViewTable(sock, RequestType::GET_ROADS);
+}
+
 void handleInitSample(SOCKET sock) {
     Request req(g_clientId, g_requestId++, RequestType::INIT_SAMPLE);
     
@@ -229,6 +278,85 @@ void handleSaveData(SOCKET sock) {
     }
 }
 
+// Latencies are p50/p99/p99.9/max in microseconds; per-type counts are
+// requests/failed/rejected; route_cache is hits/misses/entries/bytes;
+// route_coalesced is requests that shared a search/refused for a full list.
+void handleServerStats(SOCKET sock) {
+    Request req(g_clientId, g_requestId++, RequestType::STATS);
+    
+    if (!sendRequest(sock, req)) {
+        cout << "Failed to send request" << endl;
+        return;
+    }
+    Response resp = receiveResponse(sock);
+    if (resp.status != ResponseStatus::SUCCESS) {
+        displayResponse(resp);
+        return;
+    }
+    
+    cout << "\n--- Server Statistics ---" << endl;
+    istringstream fields(resp.data);
+    string field;
+    while (getline(fields, field, ';')) {
+        size_t eqPos = field.find('=');
+        if (eqPos == string::npos) continue;
+        cout << "  " << left << setw(28) << field.substr(0, eqPos) << field.substr(eqPos + 1) << endl;
+    }
+    cout << "-------------------------" << endl;
+}
+
+// Streams a record file to the server as one IMPORT: a header with the
+// record count, then the record lines themselves in large chunks.
+bool handleImportFile(SOCKET sock, const string& path) {
+    ifstream file(path);
+    if (!file.is_open()) {
+        cerr << "Cannot open " << path << endl;
+        return false;
+    }
+    
+    int records = 0;
+    string line;
+    while (getline(file, line)) {
+        if (ImportBatch::isRecordLine(line)) {
+            records++;
+        }
+    }
+    file.clear();
+    file.seekg(0);
+    
+    cout << "Importing " << records << " records from " << path << "..." << endl;
+    
+    Request req(g_clientId, g_requestId++, RequestType::IMPORT);
+    req.setParam("records", records);
+    if (!sendRequest(sock, req)) {
+        cout << "Failed to send request" << endl;
+        return false;
+    }
+    
+    string chunk;
+    chunk.reserve(IMPORT_CHUNK_SIZE + BUFFER_SIZE);
+    while (getline(file, line)) {
+        if (!ImportBatch::isRecordLine(line)) continue;
+        chunk += line;
+        chunk += '\n';
+        if (chunk.size() >= IMPORT_CHUNK_SIZE) {
+            if (!sendAll(sock, chunk)) {
+                cout << "Failed to send records" << endl;
+                return false;
+            }
+            chunk.clear();
+        }
+    }
+    if (!chunk.empty() && !sendAll(sock, chunk)) {
+        cout << "Failed to send records" << endl;
+        return false;
+    }
+    
+    Response resp = receiveResponse(sock);
+    displayResponse(resp);
+    return resp.status == ResponseStatus::SUCCESS;
+}
+
 bool initializeSockets() {
 #ifdef _WIN32
     WSADATA wsaData;
@@ -247,7 +375,10 @@ void cleanupSockets() {
 #endif
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    // client --import <file> sends one bulk import and exits.
+    string importFile = (argc >= 3 && string(argv[1]) == "--import") ? argv[2] : "";
+    
     cout << "\n";
     cout << "========================================" << endl;
     cout << "  MINI GOOGLE MAPS NAVIGATION CLIENT" << endl;
@@ -290,6 +421,13 @@ int main() {
         g_clientId = stoi(welcome.message.substr(idPos + 11));
     }
     
+    if (!importFile.empty()) {
+        bool imported = handleImportFile(sock, importFile);
+        closesocket(sock);
+        cleanupSockets();
+        return imported ? 0 : 1;
+    }
+    
     int choice;
     bool running = true;
     
@@ -299,7 +437,7 @@ int main() {
         
         if (cin.fail()) {
             clearInput();
-            cout << "Invalid input. Please enter a number 1-8." << endl;
+            cout << "Invalid input. Please enter a number 1-10." << endl;
             continue;
         }
         
@@ -326,11 +464,17 @@ int main() {
                 handleSaveData(sock);
                 break;
             case 8:
+                handleSearchLocations(sock);
+                break;
+            case 9:
+                handleServerStats(sock);
+                break;
+            case 10:
                 cout << "\nDisconnecting..." << endl;
                 running = false;
                 break;
             default:
-                cout << "Invalid choice. Please enter a number 1-8." << endl;
+                cout << "Invalid choice. Please enter a number 1-10." << endl;
         }
     }
     
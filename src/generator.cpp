@@ -0,0 +1,519 @@
+#include "../BTreeFileWriter.h"
+#include "../Location.h"
+#include "../Edge.h"
+#include "../Navigation.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <filesystem>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+const double ORIGIN_LATITUDE = 40.0;
+const double ORIGIN_LONGITUDE = -74.0;
+const double KM_PER_DEGREE = 111.195;
+const double PI = 3.14159265358979323846;
+
+// Road distance is the straight-line distance between the endpoints times
+// a detour factor, so it is never shorter than the haversine distance the
+// navigator sees between the stored coordinates.
+const double MIN_DETOUR = 1.05;
+const double MAX_DETOUR = 1.35;
+
+const long long MAX_NODES = INT_MAX / 3;
+
+// Independent random streams, so a node's coordinates or an edge's
+// direction depend only on the seed and its index.
+enum RandomStream : uint64_t {
+    STREAM_JITTER_LAT = 1,
+    STREAM_JITTER_LON,
+    STREAM_POINT_X,
+    STREAM_POINT_Y,
+    STREAM_ONE_WAY,
+    STREAM_DIRECTION,
+    STREAM_DETOUR
+};
+
+struct GeneratorOptions {
+    string mode = "grid";
+    long long nodes = 10000;
+    uint64_t seed = 42;
+    double oneWayFraction = 0.1;
+    double jitter = 0.3;
+    int neighbors = 2;
+    double spacingKm = 0.1;
+    string outputDir = "data";
+};
+
+struct GeneratorStats {
+    long long locations = 0;
+    long long edges = 0;
+    long long oneWay = 0;
+    long long components = 0;
+};
+
+uint64_t mix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Uniform in [0, 1).
+double unitRandom(uint64_t seed, uint64_t stream, uint64_t index) {
+    return (double)(mix64(seed ^ mix64(stream * 0x100000001B3ULL + index)) >> 11) * 0x1.0p-53;
+}
+
+// Location and Edge serialize doubles with the default stream precision;
+// snapping to it up front keeps the distances consistent with what the
+// server will load.
+double storedValue(double value) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%g", value);
+    return strtod(buffer, nullptr);
+}
+
+double kmPerDegreeLongitude() {
+    return KM_PER_DEGREE * cos(ORIGIN_LATITUDE * PI / 180.0);
+}
+
+class EdgeSink {
+private:
+    const GeneratorOptions& options;
+    BTreeFileWriter<int, Edge>& writer;
+    GeneratorStats& stats;
+    int nextEdgeId;
+
+public:
+    EdgeSink(const GeneratorOptions& opts, BTreeFileWriter<int, Edge>& w, GeneratorStats& s)
+        : options(opts), writer(w), stats(s), nextEdgeId(1) {}
+
+    // A one-way road runs from source to dest.
+    void add(int source, double sourceLat, double sourceLon,
+             int dest, double destLat, double destLon, const string& roadName, bool oneWay) {
+        int edgeId = nextEdgeId++;
+        double detour = MIN_DETOUR + (MAX_DETOUR - MIN_DETOUR) *
+                        unitRandom(options.seed, STREAM_DETOUR, edgeId);
+        double distance = Navigation::haversineDistance(sourceLat, sourceLon, destLat, destLon) * detour;
+
+        writer.add(edgeId, Edge(edgeId, source, dest, storedValue(distance), roadName, !oneWay));
+        stats.edges++;
+        if (oneWay) stats.oneWay++;
+    }
+};
+
+// Perturbed grid: streets run east-west, avenues north-south, and every
+// intersection is shifted by up to jitter * spacing in each direction.
+// Coordinates are recomputed from the node index, so nothing is held in
+// memory and the size is limited only by disk.
+//
+// One-way streets and avenues are one-way along their whole length, in a
+// random direction. The outer ring stays two-way, so every intersection
+// can still reach every other.
+void generateGrid(const GeneratorOptions& options, BTreeFileWriter<int, Location>& locations,
+                  BTreeFileWriter<int, Edge>& edges, GeneratorStats& stats) {
+    long long columns = (long long)ceil(sqrt((double)options.nodes));
+    double latStep = options.spacingKm / KM_PER_DEGREE;
+    double lonStep = options.spacingKm / kmPerDegreeLongitude();
+
+    auto latitudeOf = [&](long long index) {
+        double offset = (2.0 * unitRandom(options.seed, STREAM_JITTER_LAT, index) - 1.0) * options.jitter;
+        return storedValue(ORIGIN_LATITUDE + (index / columns + offset) * latStep);
+    };
+    auto longitudeOf = [&](long long index) {
+        double offset = (2.0 * unitRandom(options.seed, STREAM_JITTER_LON, index) - 1.0) * options.jitter;
+        return storedValue(ORIGIN_LONGITUDE + (index % columns + offset) * lonStep);
+    };
+
+    for (long long index = 0; index < options.nodes; index++) {
+        string name = "Street " + to_string(index / columns + 1) +
+                      " & Avenue " + to_string(index % columns + 1);
+        locations.add((int)index + 1,
+                      Location((int)index + 1, name, latitudeOf(index), longitudeOf(index), "intersection"));
+        stats.locations++;
+    }
+
+    // Streets are lines [0, rows), avenues [rows, rows + columns). The last
+    // two streets stay two-way as the last one may be partial.
+    long long rows = (options.nodes + columns - 1) / columns;
+    auto isOneWay = [&](long long line) {
+        bool outer = line == 0 || (line >= rows - 2 && line < rows) ||
+                     line == rows || line == rows + columns - 1;
+        return !outer && unitRandom(options.seed, STREAM_ONE_WAY, line) < options.oneWayFraction;
+    };
+    auto isReversed = [&](long long line) {
+        return unitRandom(options.seed, STREAM_DIRECTION, line) < 0.5;
+    };
+
+    EdgeSink sink(options, edges, stats);
+    auto addRoad = [&](long long from, long long to, long long line, const string& roadName) {
+        if (isOneWay(line) && isReversed(line)) {
+            swap(from, to);
+        }
+        sink.add((int)from + 1, latitudeOf(from), longitudeOf(from),
+                 (int)to + 1, latitudeOf(to), longitudeOf(to), roadName, isOneWay(line));
+    };
+
+    for (long long index = 0; index < options.nodes; index++) {
+        long long row = index / columns, column = index % columns;
+        long long east = index + 1;
+        long long north = index + columns;
+
+        if (east % columns != 0 && east < options.nodes) {
+            addRoad(index, east, row, "Street " + to_string(row + 1));
+        }
+        if (north < options.nodes) {
+            addRoad(index, north, rows + column, "Avenue " + to_string(column + 1));
+        }
+    }
+    stats.components = options.nodes > 0 ? 1 : 0;
+}
+
+int findRoot(vector<int>& parent, int node) {
+    while (parent[node] != node) {
+        parent[node] = parent[parent[node]];
+        node = parent[node];
+    }
+    return node;
+}
+
+const char TWO_WAY = 0;
+const char FORWARD = 1;
+const char BACKWARD = 2;
+
+// Picks a direction each road may take if it becomes one-way without
+// cutting anyone off (Robbins' theorem): in a depth-first search, tree
+// roads point away from the root and the others point back up, which keeps
+// every bridgeless part strongly connected. Bridges stay TWO_WAY.
+void orientRoads(int count, const vector<pair<int, int>>& roads, vector<char>& direction) {
+    vector<int> start(count + 1, 0);
+    for (const auto& road : roads) {
+        start[road.first + 1]++;
+        start[road.second + 1]++;
+    }
+    for (int i = 0; i < count; i++) {
+        start[i + 1] += start[i];
+    }
+    vector<int> incident(2 * roads.size());
+    {
+        vector<int> nextSlot(start.begin(), start.end() - 1);
+        for (size_t r = 0; r < roads.size(); r++) {
+            incident[nextSlot[roads[r].first]++] = (int)r;
+            incident[nextSlot[roads[r].second]++] = (int)r;
+        }
+    }
+
+    direction.assign(roads.size(), TWO_WAY);
+    vector<int> order(count, -1), low(count), parentRoad(count, -1);
+    vector<int> cursor(start.begin(), start.end() - 1);
+    vector<int> stack;
+    int visited = 0;
+
+    auto orient = [&](int road, int from) {
+        direction[road] = roads[road].first == from ? FORWARD : BACKWARD;
+    };
+
+    for (int root = 0; root < count; root++) {
+        if (order[root] >= 0) continue;
+        order[root] = low[root] = visited++;
+        stack.push_back(root);
+
+        while (!stack.empty()) {
+            int node = stack.back();
+            if (cursor[node] < start[node + 1]) {
+                int road = incident[cursor[node]++];
+                if (road == parentRoad[node]) continue;
+                int next = roads[road].first == node ? roads[road].second : roads[road].first;
+                if (order[next] < 0) {
+                    order[next] = low[next] = visited++;
+                    parentRoad[next] = road;
+                    orient(road, node);
+                    stack.push_back(next);
+                } else if (order[next] < order[node]) {
+                    low[node] = min(low[node], order[next]);
+                    orient(road, node);
+                }
+                continue;
+            }
+
+            stack.pop_back();
+            if (parentRoad[node] >= 0) {
+                int parentNode = stack.back();
+                low[parentNode] = min(low[parentNode], low[node]);
+                if (low[node] > order[parentNode]) {
+                    direction[parentRoad[node]] = TWO_WAY;
+                }
+            }
+        }
+    }
+}
+
+// Random geometric graph: points are scattered uniformly over a square
+// holding one point per spacing^2 on average, and each point is joined to
+// its k nearest neighbours, then islands are linked to their closest
+// neighbour so the map is connected. With k = 2 the average degree is
+// about 2.7, close to real road networks. Points are numbered in cell order
+// so nearby junctions get nearby IDs, as they would in an imported map.
+void generateGeometric(const GeneratorOptions& options, BTreeFileWriter<int, Location>& locations,
+                       BTreeFileWriter<int, Edge>& edges, GeneratorStats& stats) {
+    int count = (int)options.nodes;
+    int k = options.neighbors;
+    int cellsPerSide = max(1, (int)ceil(sqrt((double)count)));
+    double side = sqrt((double)count) * options.spacingKm;
+    double cellSize = side / cellsPerSide;
+
+    auto cellOf = [&](double value) {
+        return min(cellsPerSide - 1, (int)(value / cellSize));
+    };
+
+    // Bucket the points by cell with a counting sort.
+    vector<int> cellStart((size_t)cellsPerSide * cellsPerSide + 1, 0);
+    for (int i = 0; i < count; i++) {
+        double x = unitRandom(options.seed, STREAM_POINT_X, i) * side;
+        double y = unitRandom(options.seed, STREAM_POINT_Y, i) * side;
+        cellStart[(size_t)cellOf(y) * cellsPerSide + cellOf(x) + 1]++;
+    }
+    for (size_t c = 1; c < cellStart.size(); c++) {
+        cellStart[c] += cellStart[c - 1];
+    }
+
+    vector<double> xs(count), ys(count);
+    {
+        vector<int> nextSlot(cellStart.begin(), cellStart.end() - 1);
+        for (int i = 0; i < count; i++) {
+            double x = unitRandom(options.seed, STREAM_POINT_X, i) * side;
+            double y = unitRandom(options.seed, STREAM_POINT_Y, i) * side;
+            int slot = nextSlot[(size_t)cellOf(y) * cellsPerSide + cellOf(x)]++;
+            xs[slot] = x;
+            ys[slot] = y;
+        }
+    }
+
+    // The up to k nearest points to i that pass accept(j) and lie closer
+    // than sqrt(limit), by searching rings of cells outward until the next
+    // ring cannot hold anything closer.
+    auto searchNearest = [&](int i, int k, auto accept, double limit, vector<pair<double, int>>& best) {
+        best.clear();
+        int cx = cellOf(xs[i]), cy = cellOf(ys[i]);
+        for (int ring = 0; ring <= cellsPerSide; ring++) {
+            double reach = max(0, ring - 1) * cellSize;
+            if (reach * reach >= limit) break;
+            if ((int)best.size() == k && best.back().first <= reach * reach) break;
+            for (int gy = cy - ring; gy <= cy + ring; gy++) {
+                if (gy < 0 || gy >= cellsPerSide) continue;
+                bool edgeRow = gy == cy - ring || gy == cy + ring;
+                for (int gx = cx - ring; gx <= cx + ring; gx += edgeRow ? 1 : 2 * max(ring, 1)) {
+                    if (gx < 0 || gx >= cellsPerSide) continue;
+                    size_t cell = (size_t)gy * cellsPerSide + gx;
+                    for (int j = cellStart[cell]; j < cellStart[cell + 1]; j++) {
+                        if (j == i || !accept(j)) continue;
+                        double dx = xs[j] - xs[i], dy = ys[j] - ys[i];
+                        double d = dx * dx + dy * dy;
+                        if (d >= limit || ((int)best.size() == k && d >= best.back().first)) continue;
+                        if ((int)best.size() == k) best.pop_back();
+                        best.insert(upper_bound(best.begin(), best.end(), make_pair(d, j)), {d, j});
+                    }
+                }
+            }
+        }
+    };
+
+    vector<int> nearest((size_t)count * k, -1);
+    auto findNearest = [&](int begin, int end) {
+        vector<pair<double, int>> best;
+        for (int i = begin; i < end; i++) {
+            searchNearest(i, k, [](int) { return true; }, HUGE_VAL, best);
+            for (size_t n = 0; n < best.size(); n++) {
+                nearest[(size_t)i * k + n] = best[n].second;
+            }
+        }
+    };
+
+    int threads = (int)max(1u, thread::hardware_concurrency());
+    vector<thread> workers;
+    for (int t = 1; t < threads; t++) {
+        workers.emplace_back(findNearest, (int)((long long)count * t / threads),
+                             (int)((long long)count * (t + 1) / threads));
+    }
+    findNearest(0, (int)((long long)count / threads));
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    auto isNearest = [&](int from, int to) {
+        const int* list = &nearest[(size_t)from * k];
+        return find(list, list + k, to) != list + k;
+    };
+
+    vector<pair<int, int>> roads;
+    vector<int> parent(count);
+    for (int i = 0; i < count; i++) parent[i] = i;
+    long long components = count;
+    auto join = [&](int a, int b) {
+        roads.push_back({a, b});
+        int rootA = findRoot(parent, a), rootB = findRoot(parent, b);
+        if (rootA != rootB) {
+            parent[rootA] = rootB;
+            components--;
+        }
+    };
+
+    for (int i = 0; i < count; i++) {
+        for (int n = 0; n < k; n++) {
+            int j = nearest[(size_t)i * k + n];
+            // A mutual pair is joined once, by its lower ID.
+            if (j < 0 || (j < i && isNearest(j, i))) continue;
+            join(i, j);
+        }
+    }
+    vector<int>().swap(nearest);
+
+    // A k-nearest graph leaves small islands. Join each island to the
+    // closest point outside it, Boruvka-style, until one component is left;
+    // every round at least halves the number of islands. The best link found
+    // so far bounds the search from the island's other points.
+    vector<int> component(count), componentSize(count);
+    vector<pair<double, pair<int, int>>> shortest(count);
+    vector<pair<double, int>> best;
+    while (components > 1) {
+        fill(componentSize.begin(), componentSize.end(), 0);
+        for (int i = 0; i < count; i++) {
+            component[i] = findRoot(parent, i);
+            componentSize[component[i]]++;
+        }
+        int largest = (int)(max_element(componentSize.begin(), componentSize.end()) - componentSize.begin());
+
+        fill(shortest.begin(), shortest.end(), make_pair(HUGE_VAL, make_pair(-1, -1)));
+        for (int i = 0; i < count; i++) {
+            int own = component[i];
+            if (own == largest) continue;
+            searchNearest(i, 1, [&](int j) { return component[j] != own; }, shortest[own].first, best);
+            if (!best.empty() && best[0].first < shortest[own].first) {
+                shortest[own] = {best[0].first, {i, best[0].second}};
+            }
+        }
+        for (int i = 0; i < count; i++) {
+            const auto& link = shortest[i].second;
+            if (link.first >= 0 && findRoot(parent, link.first) != findRoot(parent, link.second)) {
+                join(link.first, link.second);
+            }
+        }
+    }
+
+    // From here on the planar coordinates are replaced by the stored ones.
+    double kmPerLon = kmPerDegreeLongitude();
+    for (int i = 0; i < count; i++) {
+        ys[i] = storedValue(ORIGIN_LATITUDE + ys[i] / KM_PER_DEGREE);
+        xs[i] = storedValue(ORIGIN_LONGITUDE + xs[i] / kmPerLon);
+        locations.add(i + 1, Location(i + 1, "Junction " + to_string(i + 1), ys[i], xs[i], "intersection"));
+        stats.locations++;
+    }
+
+    vector<char> direction;
+    orientRoads(count, roads, direction);
+
+    EdgeSink sink(options, edges, stats);
+    for (size_t r = 0; r < roads.size(); r++) {
+        int i = roads[r].first, j = roads[r].second;
+        bool oneWay = direction[r] != TWO_WAY &&
+                      unitRandom(options.seed, STREAM_ONE_WAY, r) < options.oneWayFraction;
+        if (oneWay && direction[r] == BACKWARD) {
+            swap(i, j);
+        }
+        sink.add(i + 1, ys[i], xs[i], j + 1, ys[j], xs[j], "Road " + to_string(r + 1), oneWay);
+    }
+    stats.components = components;
+}
+
+void printUsage() {
+    cout << "Usage: generator grid|geometric [options]" << endl;
+    cout << "  --nodes N        number of locations (default 10000)" << endl;
+    cout << "  --seed S         random seed (default 42)" << endl;
+    cout << "  --one-way F      fraction of one-way roads, 0..1 (default 0.1)" << endl;
+    cout << "  --spacing KM     average distance between neighbouring nodes (default 0.1)" << endl;
+    cout << "  --jitter F       grid: perturbation as a fraction of the spacing (default 0.3)" << endl;
+    cout << "  --neighbors K    geometric: nearest neighbours joined per node (default 2)" << endl;
+    cout << "  --out DIR        output directory (default data)" << endl;
+}
+
+bool parseOptions(int argc, char* argv[], GeneratorOptions& options) {
+    if (argc < 2) return false;
+    options.mode = argv[1];
+    if (options.mode != "grid" && options.mode != "geometric") return false;
+
+    for (int i = 2; i + 1 < argc; i += 2) {
+        string flag = argv[i];
+        string value = argv[i + 1];
+        try {
+            if (flag == "--nodes") options.nodes = stoll(value);
+            else if (flag == "--seed") options.seed = stoull(value);
+            else if (flag == "--one-way") options.oneWayFraction = stod(value);
+            else if (flag == "--spacing") options.spacingKm = stod(value);
+            else if (flag == "--jitter") options.jitter = stod(value);
+            else if (flag == "--neighbors") options.neighbors = stoi(value);
+            else if (flag == "--out") options.outputDir = value;
+            else return false;
+        } catch (...) {
+            return false;
+        }
+    }
+    if (argc % 2 != 0) return false;
+
+    return options.nodes > 0 && options.nodes <= MAX_NODES &&
+           options.oneWayFraction >= 0.0 && options.oneWayFraction <= 1.0 &&
+           options.spacingKm > 0.0 && options.jitter >= 0.0 && options.jitter < 0.5 &&
+           options.neighbors >= 1 && options.neighbors <= 16;
+}
+
+int main(int argc, char* argv[]) {
+    GeneratorOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    error_code ec;
+    fs::create_directories(options.outputDir, ec);
+
+    string locationFile = options.outputDir + "/locations_btree.dat";
+    string edgeFile = options.outputDir + "/edges_btree.dat";
+    BTreeFileWriter<int, Location> locations;
+    BTreeFileWriter<int, Edge> edges;
+    if (!locations.open(locationFile) || !edges.open(edgeFile)) {
+        cerr << "Cannot write to " << options.outputDir << endl;
+        return 1;
+    }
+
+    auto start = chrono::steady_clock::now();
+    GeneratorStats stats;
+    if (options.mode == "grid") {
+        generateGrid(options, locations, edges, stats);
+    } else {
+        generateGeometric(options, locations, edges, stats);
+    }
+
+    if (!locations.close() || !edges.close()) {
+        cerr << "Failed to write " << options.outputDir << endl;
+        return 1;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "Generated " << options.mode << " map in " << options.outputDir
+         << " (seed " << options.seed << ")" << endl;
+    cout << "  locations: " << stats.locations << endl;
+    cout << "  roads: " << stats.edges << " (" << stats.oneWay << " one-way)" << endl;
+    cout << "  average degree: " << (stats.locations ? 2.0 * stats.edges / stats.locations : 0.0) << endl;
+    cout << "  connected components: " << stats.components << endl;
+    cout << "  time: " << seconds << " s" << endl;
+    return 0;
+}
@@ -0,0 +1,571 @@
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #pragma comment(lib, "ws2_32.lib")
+#else
+    #include <sys/socket.h>
+    #include <sys/time.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+    #define SOCKET int
+    #define INVALID_SOCKET -1
+    #define SOCKET_ERROR -1
+    #define closesocket close
+#endif
+
+#include "../Request.h"
+#include "../LatencyHistogram.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+const int BUFFER_SIZE = 4096;
+const int RECEIVE_POLL_MS = 100;
+
+// Operations the generator can issue; the mix gives each a weight.
+enum LoadOp {
+    OP_FIND_PATH,
+    OP_GET_LOCATION,
+    OP_ADD_ROAD,
+    OP_COUNT
+};
+
+const char* OP_NAMES[OP_COUNT] = {"FIND_PATH", "GET_LOCATION", "ADD_ROAD"};
+const char* OP_KEYS[OP_COUNT] = {"find", "get", "road"};
+
+struct LoadOptions {
+    string host = "127.0.0.1";
+    int port = 8080;
+    int connections = 4;
+    double rate = 0.0;
+    double durationSec = 10.0;
+    double warmupSec = 1.0;
+    double timeoutSec = 5.0;
+    bool openLoop = false;
+    int nodes = 10000;
+    int weights[OP_COUNT] = {60, 30, 10};
+    unsigned seed = 42;
+    int deadlineMs = 0;
+};
+
+struct OpStats {
+    LatencyHistogram latency;
+    long long sent = 0;
+    long long ok = 0;
+    long long failed = 0;
+};
+
+struct ConnectionStats {
+    OpStats ops[OP_COUNT];
+    long long ioErrors = 0;
+    long long timeouts = 0;
+    Clock::time_point lastResponse;
+
+    void merge(const ConnectionStats& other) {
+        for (int op = 0; op < OP_COUNT; op++) {
+            ops[op].latency.merge(other.ops[op].latency);
+            ops[op].sent += other.ops[op].sent;
+            ops[op].ok += other.ops[op].ok;
+            ops[op].failed += other.ops[op].failed;
+        }
+        ioErrors += other.ioErrors;
+        timeouts += other.timeouts;
+        lastResponse = max(lastResponse, other.lastResponse);
+    }
+};
+
+class Connection {
+private:
+    SOCKET sock;
+    string pending;
+
+public:
+    int clientId;
+
+    Connection() : sock(INVALID_SOCKET), clientId(0) {}
+    ~Connection() { disconnect(); }
+
+    bool open(const LoadOptions& options) {
+        sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (sock == INVALID_SOCKET) {
+            return false;
+        }
+        int noDelay = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+
+        // A short receive timeout lets readers notice the end of the run.
+#ifdef _WIN32
+        DWORD timeout = RECEIVE_POLL_MS;
+#else
+        timeval timeout = {0, RECEIVE_POLL_MS * 1000};
+#endif
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(options.port);
+        inet_pton(AF_INET, options.host.c_str(), &address.sin_addr);
+        if (connect(sock, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR) {
+            disconnect();
+            return false;
+        }
+
+        // The server greets each connection with its client ID.
+        string welcome;
+        Clock::time_point deadline = Clock::now() + chrono::seconds(5);
+        if (readLine(welcome, deadline) != 1) {
+            disconnect();
+            return false;
+        }
+        size_t idPos = welcome.rfind("Client ID: ");
+        clientId = idPos != string::npos ? atoi(welcome.c_str() + idPos + 11) : 0;
+        return true;
+    }
+
+    void disconnect() {
+        if (sock != INVALID_SOCKET) {
+            closesocket(sock);
+            sock = INVALID_SOCKET;
+        }
+    }
+
+    bool sendLine(const string& line) {
+        string data = line + "\n";
+        size_t sent = 0;
+        while (sent < data.size()) {
+            int result = send(sock, data.c_str() + sent, (int)(data.size() - sent), 0);
+            if (result == SOCKET_ERROR || result == 0) {
+                return false;
+            }
+            sent += result;
+        }
+        return true;
+    }
+
+    // 1 with a line, 0 when the deadline passed first, -1 on error.
+    int readLine(string& line, Clock::time_point deadline) {
+        char buffer[BUFFER_SIZE];
+        while (true) {
+            size_t newline = pending.find('\n');
+            if (newline != string::npos) {
+                line = pending.substr(0, newline);
+                pending.erase(0, newline + 1);
+                return 1;
+            }
+            if (Clock::now() >= deadline) {
+                return 0;
+            }
+            int received = recv(sock, buffer, BUFFER_SIZE, 0);
+            if (received > 0) {
+                pending.append(buffer, received);
+            } else if (received == 0) {
+                return -1;
+            } else {
+#ifdef _WIN32
+                if (WSAGetLastError() != WSAETIMEDOUT) return -1;
+#else
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) return -1;
+#endif
+            }
+        }
+    }
+};
+
+class RequestMaker {
+private:
+    mt19937 rng;
+    discrete_distribution<int> pickOp;
+    uniform_int_distribution<int> pickNode;
+    uniform_real_distribution<double> pickDistance;
+    int deadlineMs;
+
+    string finish(Request& req) {
+        if (deadlineMs > 0) {
+            req.setParam("deadline_ms", deadlineMs);
+        }
+        return req.serialize();
+    }
+
+public:
+    RequestMaker(const LoadOptions& opts, unsigned seed)
+        : rng(seed),
+          pickOp(opts.weights, opts.weights + OP_COUNT),
+          pickNode(1, max(1, opts.nodes)), pickDistance(0.1, 5.0), deadlineMs(opts.deadlineMs) {}
+
+    LoadOp nextOp() { return (LoadOp)pickOp(rng); }
+
+    string make(LoadOp op, int clientId, int requestId) {
+        if (op == OP_FIND_PATH) {
+            Request req(clientId, requestId, RequestType::FIND_PATH);
+            req.setParam("sourceId", pickNode(rng));
+            req.setParam("destId", pickNode(rng));
+            return finish(req);
+        }
+        if (op == OP_GET_LOCATION) {
+            Request req(clientId, requestId, RequestType::GET_LOCATION);
+            req.setParam("id", pickNode(rng));
+            return finish(req);
+        }
+        Request req(clientId, requestId, RequestType::ADD_ROAD);
+        req.setParam("sourceId", pickNode(rng));
+        req.setParam("destId", pickNode(rng));
+        req.setParam("distance", pickDistance(rng));
+        req.setParam("roadName", "Load Test Road");
+        return finish(req);
+    }
+};
+
+uint64_t microsBetween(Clock::time_point from, Clock::time_point to) {
+    return to > from ? (uint64_t)chrono::duration_cast<chrono::microseconds>(to - from).count() : 0;
+}
+
+bool parseResponse(const string& line, Response& response) {
+    try {
+        response = Response::deserialize(line);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+void recordResponse(ConnectionStats& stats, LoadOp op, const Response& response,
+                    Clock::time_point intended, Clock::time_point done) {
+    stats.ops[op].latency.record(microsBetween(intended, done));
+    if (response.status == ResponseStatus::SUCCESS) {
+        stats.ops[op].ok++;
+    } else {
+        stats.ops[op].failed++;
+    }
+    stats.lastResponse = max(stats.lastResponse, done);
+}
+
+// Closed loop: each connection waits for a response before sending again.
+// With a target rate the sends follow a fixed schedule and latency is taken
+// from the scheduled time, so a stall is charged to every request it
+// delayed rather than hidden by the pause (coordinated omission). Without
+// a rate it runs flat out and latency is plain service time. Either way
+// sending stops at the end of the run, even if the schedule fell behind.
+void runClosedLoop(const LoadOptions& options, int index, Clock::time_point start,
+                   ConnectionStats& stats) {
+    Connection connection;
+    if (!connection.open(options)) {
+        stats.ioErrors++;
+        return;
+    }
+    RequestMaker maker(options, options.seed + index);
+
+    Clock::time_point measureFrom = start + chrono::duration_cast<Clock::duration>(
+        chrono::duration<double>(options.warmupSec));
+    Clock::time_point end = start + chrono::duration_cast<Clock::duration>(
+        chrono::duration<double>(options.durationSec));
+    Clock::duration interval = options.rate > 0
+        ? chrono::duration_cast<Clock::duration>(chrono::duration<double>(options.connections / options.rate))
+        : Clock::duration::zero();
+    Clock::time_point next = start + interval * index / options.connections;
+
+    for (int requestId = 1; ; requestId++) {
+        Clock::time_point intended = options.rate > 0 ? next : Clock::now();
+        if (intended >= end || Clock::now() >= end) break;
+        next += interval;
+        this_thread::sleep_until(intended);
+
+        LoadOp op = maker.nextOp();
+        bool measured = intended >= measureFrom;
+        if (!connection.sendLine(maker.make(op, connection.clientId, requestId))) {
+            stats.ioErrors++;
+            return;
+        }
+        if (measured) stats.ops[op].sent++;
+
+        string line;
+        Clock::time_point deadline = Clock::now() + chrono::duration_cast<Clock::duration>(
+            chrono::duration<double>(options.timeoutSec));
+        int status = connection.readLine(line, deadline);
+        Response response;
+        if (status <= 0 || !parseResponse(line, response)) {
+            if (status == 0) stats.timeouts++; else stats.ioErrors++;
+            return;
+        }
+        if (measured) {
+            recordResponse(stats, op, response, intended, Clock::now());
+        }
+    }
+}
+
+// Open loop: requests go out on schedule whether or not earlier ones have
+// been answered, as independent users would send them, and a reader
+// thread matches responses by request ID. Latency runs from the scheduled
+// send time.
+void runOpenLoop(const LoadOptions& options, int index, Clock::time_point start,
+                 ConnectionStats& stats) {
+    Connection connection;
+    if (!connection.open(options)) {
+        stats.ioErrors++;
+        return;
+    }
+    RequestMaker maker(options, options.seed + index);
+
+    struct Pending {
+        LoadOp op;
+        Clock::time_point intended;
+        bool measured;
+    };
+    unordered_map<int, Pending> pending;
+    mutex pendingMutex;
+    atomic<bool> sending(true);
+    atomic<bool> failed(false);
+
+    Clock::time_point measureFrom = start + chrono::duration_cast<Clock::duration>(
+        chrono::duration<double>(options.warmupSec));
+    Clock::time_point end = start + chrono::duration_cast<Clock::duration>(
+        chrono::duration<double>(options.durationSec));
+    Clock::duration interval = chrono::duration_cast<Clock::duration>(
+        chrono::duration<double>(options.connections / options.rate));
+
+    thread reader([&] {
+        Clock::time_point drainUntil = Clock::time_point::max();
+        while (!failed.load()) {
+            if (!sending.load() && drainUntil == Clock::time_point::max()) {
+                drainUntil = Clock::now() + chrono::duration_cast<Clock::duration>(
+                    chrono::duration<double>(options.timeoutSec));
+            }
+            {
+                lock_guard<mutex> lock(pendingMutex);
+                if (!sending.load() && pending.empty()) break;
+            }
+            if (Clock::now() >= drainUntil) break;
+
+            string line;
+            int status = connection.readLine(line, Clock::now() + chrono::milliseconds(RECEIVE_POLL_MS));
+            if (status < 0) {
+                failed.store(true);
+                break;
+            }
+            Response response;
+            if (status == 0 || !parseResponse(line, response)) continue;
+
+            Clock::time_point done = Clock::now();
+            lock_guard<mutex> lock(pendingMutex);
+            auto it = pending.find(response.requestId);
+            if (it == pending.end()) continue;
+            if (it->second.measured) {
+                recordResponse(stats, it->second.op, response, it->second.intended, done);
+            }
+            pending.erase(it);
+        }
+    });
+
+    Clock::time_point next = start + interval * index / options.connections;
+    for (int requestId = 1; next < end && !failed.load(); requestId++) {
+        Clock::time_point intended = next;
+        next += interval;
+        this_thread::sleep_until(intended);
+
+        LoadOp op = maker.nextOp();
+        bool measured = intended >= measureFrom;
+        {
+            lock_guard<mutex> lock(pendingMutex);
+            pending[requestId] = {op, intended, measured};
+        }
+        if (!connection.sendLine(maker.make(op, connection.clientId, requestId))) {
+            failed.store(true);
+            break;
+        }
+        if (measured) stats.ops[op].sent++;
+    }
+    sending.store(false);
+    reader.join();
+
+    if (failed.load()) stats.ioErrors++;
+    for (const auto& [requestId, request] : pending) {
+        if (request.measured) stats.timeouts++;
+    }
+}
+
+string formatMillis(uint64_t micros) {
+    ostringstream out;
+    out << fixed << setprecision(3) << micros / 1000.0;
+    return out.str();
+}
+
+void printRow(const string& name, const OpStats& stats) {
+    const LatencyHistogram& h = stats.latency;
+    cout << "  " << left << setw(13) << name << right
+         << setw(10) << stats.sent << setw(10) << stats.ok << setw(9) << stats.failed
+         << setw(11) << formatMillis(h.percentile(0.50))
+         << setw(11) << formatMillis(h.percentile(0.99))
+         << setw(11) << formatMillis(h.percentile(0.999))
+         << setw(11) << formatMillis(h.getMax()) << endl;
+}
+
+void printReport(const LoadOptions& options, Clock::time_point measureFrom, const ConnectionStats& total) {
+    double window = max(options.durationSec - options.warmupSec,
+                        chrono::duration<double>(total.lastResponse - measureFrom).count());
+    OpStats all;
+    for (int op = 0; op < OP_COUNT; op++) {
+        all.latency.merge(total.ops[op].latency);
+        all.sent += total.ops[op].sent;
+        all.ok += total.ops[op].ok;
+        all.failed += total.ops[op].failed;
+    }
+
+    cout << "\n  " << left << setw(13) << "operation" << right
+         << setw(10) << "sent" << setw(10) << "ok" << setw(9) << "failed"
+         << setw(11) << "p50 ms" << setw(11) << "p99 ms" << setw(11) << "p99.9 ms"
+         << setw(11) << "max ms" << endl;
+    for (int op = 0; op < OP_COUNT; op++) {
+        if (options.weights[op] > 0) printRow(OP_NAMES[op], total.ops[op]);
+    }
+    printRow("total", all);
+
+    cout << "\n  throughput: " << fixed << setprecision(1)
+         << (all.ok + all.failed) / window << " responses/s, " << all.ok / window << " successful/s";
+    if (options.rate > 0) {
+        cout << " (target " << options.rate << ")";
+    }
+    cout << endl;
+    cout << "  errors: " << all.failed << " failed responses, " << total.timeouts << " timeouts, "
+         << total.ioErrors << " connection errors" << endl;
+}
+
+void printUsage() {
+    cout << "Usage: loadgen [options]" << endl;
+    cout << "  --host H          server address (default 127.0.0.1)" << endl;
+    cout << "  --port P          server port (default 8080)" << endl;
+    cout << "  --connections N   concurrent connections (default 4)" << endl;
+    cout << "  --rate R          target requests/s over all connections; 0 = as fast as possible" << endl;
+    cout << "  --open            open loop: send on schedule without waiting (needs --rate)" << endl;
+    cout << "  --duration S      run length in seconds (default 10)" << endl;
+    cout << "  --warmup S        seconds excluded from the results (default 1)" << endl;
+    cout << "  --timeout S       response timeout in seconds (default 5)" << endl;
+    cout << "  --nodes N         location IDs 1..N used in requests (default 10000)" << endl;
+    cout << "  --mix find=W,get=W,road=W   operation weights (default find=60,get=30,road=10)" << endl;
+    cout << "  --seed S          random seed (default 42)" << endl;
+    cout << "  --deadline-ms MS  send deadline_ms with every request; 0 = none (default)" << endl;
+}
+
+bool parseMix(const string& text, LoadOptions& options) {
+    int weights[OP_COUNT] = {0, 0, 0};
+    stringstream parts(text);
+    string part;
+    while (getline(parts, part, ',')) {
+        size_t eq = part.find('=');
+        if (eq == string::npos) return false;
+        string key = part.substr(0, eq);
+        int op = 0;
+        while (op < OP_COUNT && key != OP_KEYS[op]) op++;
+        if (op == OP_COUNT) return false;
+        weights[op] = atoi(part.c_str() + eq + 1);
+        if (weights[op] < 0) return false;
+    }
+    if (weights[0] + weights[1] + weights[2] == 0) return false;
+    copy(weights, weights + OP_COUNT, options.weights);
+    return true;
+}
+
+bool parseOptions(int argc, char* argv[], LoadOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        string flag = argv[i];
+        if (flag == "--open") {
+            options.openLoop = true;
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        string value = argv[++i];
+        try {
+            if (flag == "--host") options.host = value;
+            else if (flag == "--port") options.port = stoi(value);
+            else if (flag == "--connections") options.connections = stoi(value);
+            else if (flag == "--rate") options.rate = stod(value);
+            else if (flag == "--duration") options.durationSec = stod(value);
+            else if (flag == "--warmup") options.warmupSec = stod(value);
+            else if (flag == "--timeout") options.timeoutSec = stod(value);
+            else if (flag == "--nodes") options.nodes = stoi(value);
+            else if (flag == "--seed") options.seed = (unsigned)stoul(value);
+            else if (flag == "--deadline-ms") options.deadlineMs = stoi(value);
+            else if (flag == "--mix") {
+                if (!parseMix(value, options)) return false;
+            } else return false;
+        } catch (...) {
+            return false;
+        }
+    }
+    return options.connections > 0 && options.durationSec > options.warmupSec &&
+           options.warmupSec >= 0 && options.rate >= 0 && options.timeoutSec > 0 &&
+           (!options.openLoop || options.rate > 0);
+}
+
+int main(int argc, char* argv[]) {
+    LoadOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        cerr << "WSAStartup failed" << endl;
+        return 1;
+    }
+#endif
+
+    cout << "Load test against " << options.host << ":" << options.port << ": "
+         << (options.openLoop ? "open" : "closed") << " loop, "
+         << options.connections << " connections, ";
+    if (options.rate > 0) {
+        cout << "target " << options.rate << " requests/s, ";
+    } else {
+        cout << "unthrottled, ";
+    }
+    cout << options.durationSec << " s (" << options.warmupSec << " s warm-up)" << endl;
+
+    vector<ConnectionStats> stats(options.connections);
+    vector<thread> workers;
+    Clock::time_point start = Clock::now() + chrono::milliseconds(200);
+    for (int i = 0; i < options.connections; i++) {
+        workers.emplace_back([&, i] {
+            if (options.openLoop) {
+                runOpenLoop(options, i, start, stats[i]);
+            } else {
+                runClosedLoop(options, i, start, stats[i]);
+            }
+        });
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    ConnectionStats total;
+    for (const ConnectionStats& connection : stats) {
+        total.merge(connection);
+    }
+    printReport(options, start + chrono::duration_cast<Clock::duration>(
+        chrono::duration<double>(options.warmupSec)), total);
+
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    long long failures = total.ioErrors + total.timeouts;
+    return failures > 0 ? 1 : 0;
+}
@@ -8,7 +8,9 @@
     #include <sys/socket.h>
     #include <netinet/in.h>
     #include <arpa/inet.h>
+    #include <sys/uio.h>
     #include <unistd.h>
+    #include <cerrno>
     #define SOCKET int
     #define INVALID_SOCKET -1
     #define SOCKET_ERROR -1
@@ -22,19 +24,32 @@
 #include "../Graph.h"
 #include "../Navigation.h"
 #include "../DatabaseManager.h"
-#include "../CircularQueue.h"
+#include "../RequestScheduler.h"
 #include "../Request.h"
+#include "../ImportBatch.h"
+#include "../RoadNetworkImporter.h"
+#include "../Logger.h"
+#include "../ServerStats.h"
+#include "../RouteCache.h"
+#include "../SingleFlight.h"
+#include "../ResponseWriter.h"
 
 #include <iostream>
 #include <string>
 #include <thread>
 #include <vector>
+#include <algorithm>
 #include <atomic>
 #include <mutex>
 #include <sstream>
 #include <iomanip>
 #include <chrono>
 #include <ctime>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <cstring>
+#include <cstdio>
 
 using namespace std;
 
@@ -42,45 +57,471 @@ const int SERVER_PORT = 8080;
 const int MAX_CLIENTS = 10;
 const int BUFFER_SIZE = 4096;
 const int NUM_WORKER_THREADS = 4;
-const size_t QUEUE_CAPACITY = 100;
+const int DEFAULT_SEARCH_LIMIT = 10;
+const int MAX_SEARCH_LIMIT = 100;
+const int METRICS_DUMP_INTERVAL_MS = 5000;
+const int DEFAULT_PAGE_LIMIT = 1000;
+const int MAX_PAGE_LIMIT = 10000;
+
+// One accepted client. Responses to it are written by whichever thread
+// finishes the request, so writeLock keeps them whole and in one piece on
+// the wire, and the writer's buffers are reused from one response to the
+// next. The client thread and every queued or parked request hold a
+// reference; the socket is closed when the last one lets go, so a late
+// answer never lands on a descriptor that was reused for someone else.
+// disconnected is raised once the client has gone (recv returned 0 or a
+// send failed); it cancels whatever is still queued or running for it.
+struct ClientConnection {
+    SOCKET socket;
+    int clientId;
+    mutex writeLock;
+    ResponseWriter writer;
+    atomic<bool> disconnected;
+    
+    ClientConnection(SOCKET s, int id) : socket(s), clientId(id), disconnected(false) {}
+    ~ClientConnection() { closesocket(socket); }
+};
+
+// Per RequestClass: workers it may hold, queue limit range, target queue
+// wait and the age at which its oldest request jumps the higher classes.
+// BULK never gets more than one worker, so reads always have the rest.
+const SchedulerClassConfig SCHEDULER_CLASSES[REQUEST_CLASS_COUNT] = {
+    { NUM_WORKER_THREADS, 32, 256, 20000, 0 },
+    { 2, 8, 64, 50000, 50000 },
+    { 1, 1, 8, 1000000, 250000 }
+};
+
+// A request waiting for a worker. An IMPORT carries the records its
+// connection has already staged, so applying them is scheduled as BULK
+// work like any other long write.
+struct QueuedRequest {
+    Request request;
+    shared_ptr<ClientConnection> connection;
+    shared_ptr<ImportBatch> importBatch;
+};
 
 DatabaseManager* g_database = nullptr;
-CircularQueue<pair<Request, SOCKET>, QUEUE_CAPACITY> g_requestQueue;
+RequestScheduler<QueuedRequest, REQUEST_CLASS_COUNT> g_requestQueue(SCHEDULER_CLASSES);
+RouteCache g_routeCache;
+
+// A FIND_PATH parked on an identical search that another worker is
+// running; that worker answers it when the search ends.
+struct RouteWaiter {
+    Request request;
+    shared_ptr<ClientConnection> connection;
+    RequestTimings timings;
+    chrono::steady_clock::time_point parkedAt;
+};
+
+SingleFlight<RouteKey, RouteWaiter, RouteKeyHash> g_routeFlights;
 atomic<bool> g_serverRunning(true);
 mutex g_dbMutex;
-mutex g_logMutex;
 
-map<int, SOCKET> g_clientSockets;
-mutex g_clientMutex;
 atomic<int> g_nextClientId(1);
 
-void log(const string& message) {
-    lock_guard<mutex> lock(g_logMutex);
+// Lifecycle messages; per-request lines go through LOG_REQUEST so they
+// cost nothing unless compiled in. Neither blocks on stdout.
+void log(const string& message, LogLevel level = LogLevel::INFO) {
+    Logger::instance().write(level, message);
+}
+
+// Sends all slices with as few calls as the kernel allows, picking up
+// where a partial write stopped. False if the client has gone away.
+bool sendSlices(SOCKET socket, ResponseWriter::Slice* slices, int count) {
+    int first = 0;
+    while (first < count) {
+        size_t sent;
+#ifdef _WIN32
+        WSABUF buffers[ResponseWriter::MAX_SLICES];
+        for (int i = first; i < count; i++) {
+            buffers[i - first].buf = const_cast<char*>(slices[i].data);
+            buffers[i - first].len = (ULONG)slices[i].size;
+        }
+        DWORD written = 0;
+        if (WSASend(socket, buffers, count - first, &written, 0, NULL, NULL) == SOCKET_ERROR) {
+            return false;
+        }
+        sent = written;
+#else
+        iovec buffers[ResponseWriter::MAX_SLICES];
+        for (int i = first; i < count; i++) {
+            buffers[i - first].iov_base = const_cast<char*>(slices[i].data);
+            buffers[i - first].iov_len = slices[i].size;
+        }
+        msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = buffers;
+        message.msg_iovlen = count - first;
+        int flags = 0;
+#ifdef MSG_NOSIGNAL
+        flags = MSG_NOSIGNAL;
+#endif
+        ssize_t written = sendmsg(socket, &message, flags);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        sent = (size_t)written;
+#endif
+        while (first < count && sent >= slices[first].size) {
+            sent -= slices[first].size;
+            first++;
+        }
+        if (first < count) {
+            slices[first].data += sent;
+            slices[first].size -= sent;
+        }
+    }
+    return true;
+}
+
+bool sendResponse(ClientConnection& connection, const Response& response) {
+    if (connection.disconnected) {
+        return false;
+    }
+    lock_guard<mutex> lock(connection.writeLock);
+    ResponseWriter::Slice slices[ResponseWriter::MAX_SLICES];
+    int count = connection.writer.format(response, slices);
+    if (!sendSlices(connection.socket, slices, count)) {
+        connection.disconnected = true;
+        return false;
+    }
+    return true;
+}
+
+CancellationToken cancellationFor(const Request& req, const ClientConnection& connection) {
+    return CancellationToken(&connection.disconnected, req.deadline);
+}
+
+// TIMEOUT answer for a request whose deadline passed before it got to run
+// (or finish); elapsed is measured from when it was read.
+Response deadlineResponse(const Request& req, const char* where) {
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - req.receivedAt);
+    return Response::timeout(req.clientId, req.requestId,
+        "Deadline of " + req.getParam(ParamKey::DEADLINE_MS) + " ms exceeded " + where +
+        " after " + to_string(elapsed.count()) + " ms");
+}
+
+ServerGauges currentGauges() {
+    ServerGauges gauges;
+    gauges.queueDepth = 0;
+    gauges.queueCapacity = 0;
+    for (int c = 0; c < REQUEST_CLASS_COUNT; c++) {
+        gauges.classDepth[c] = g_requestQueue.size(c);
+        gauges.classLimit[c] = g_requestQueue.limit(c);
+        gauges.classRunning[c] = g_requestQueue.running(c);
+        gauges.queueDepth += gauges.classDepth[c];
+        gauges.queueCapacity += gauges.classLimit[c];
+    }
+    gauges.routeCacheHits = g_routeCache.getHits();
+    gauges.routeCacheMisses = g_routeCache.getMisses();
+    gauges.routeCacheEntries = g_routeCache.getSize();
+    gauges.routeCacheBytes = g_routeCache.getBytes();
+    gauges.routeCoalesced = g_routeFlights.getJoined();
+    gauges.routeCoalesceRefused = g_routeFlights.getRefused();
+    return gauges;
+}
+
+// FIND_PATH explain=1 payload: how the search went, for diagnosing slow
+// queries one at a time.
+// A cached or shared result keeps the profile of the search that produced
+// it; source says which of miss, hit or shared this answer was.
+string formatExplain(const PathResult& result, const char* source) {
+    if (!Navigation::isProfilingEnabled()) {
+        return "explain=disabled";
+    }
+    const SearchProfile& profile = result.profile;
+    return "explain=engine:" + string(profile.engine) +
+           ",cache:" + source +
+           ",settled:" + to_string(result.nodesSettled) +
+           ",scanned:" + to_string(profile.edgesScanned) +
+           ",relaxed:" + to_string(profile.edgesRelaxed) +
+           ",pushes:" + to_string(profile.heapPushes) +
+           ",pops:" + to_string(profile.heapPops) +
+           ",frontier:" + to_string(profile.maxFrontier) +
+           ",setup_us:" + to_string(profile.setupMicros) +
+           ",search_us:" + to_string(profile.searchMicros) +
+           ",path_us:" + to_string(profile.pathMicros);
+}
+
+// Takes g_dbMutex and records how long that took.
+unique_lock<mutex> lockDatabase(RequestTimings& timings) {
+    auto requestedAt = chrono::steady_clock::now();
+    unique_lock<mutex> lock(g_dbMutex);
+    timings.set(RequestPhase::LOCK_WAIT, chrono::steady_clock::now() - requestedAt);
+    return lock;
+}
+
+// FIND_PATH data for a found route. Names are read straight from the
+// graph, so the caller holds g_dbMutex; this runs once per search and the
+// text is cached with the result.
+string formatRoute(const PathResult& result) {
+    string out = "path=";
+    for (size_t i = 0; i < result.path.size(); i++) {
+        if (i > 0) out += "->";
+        const Location* location = g_database->getGraph()->findNode(result.path[i]);
+        if (location != nullptr) {
+            out += location->name;
+        }
+        out += '(';
+        ResponseWriter::appendInt(out, result.path[i]);
+        out += ')';
+    }
+    char distance[32];
+    snprintf(distance, sizeof(distance), "%.2f", result.totalDistance);
+    out += ";distance=";
+    out += distance;
+    return out;
+}
+
+// Builds the FIND_PATH answer for one request; several requests can share
+// a route, each with its own IDs and explain flag. Without explain the
+// response points at the cached payload instead of copying it.
+Response routeResponse(const Request& req, const shared_ptr<const CachedRoute>& route, const char* source) {
+    bool explain = req.getParamBool(ParamKey::EXPLAIN);
+    const PathResult& result = route->result;
     
-    auto now = chrono::system_clock::now();
-    auto time = chrono::system_clock::to_time_t(now);
+    if (!result.found) {
+        Response response = result.aborted
+            ? deadlineResponse(req, "during search")
+            : Response::error(req.clientId, req.requestId, result.errorMessage);
+        if (explain) {
+            response.data = formatExplain(result, source);
+        }
+        return response;
+    }
     
-    cout << "[" << put_time(localtime(&time), "%H:%M:%S") << "] " 
-         << message << endl;
+    Response response(req.clientId, req.requestId, ResponseStatus::SUCCESS, "Path found");
+    if (explain) {
+        response.data = route->payload + ";" + formatExplain(result, source);
+    } else {
+        response.sharedData = shared_ptr<const string>(route, &route->payload);
+    }
+    return response;
 }
 
-void sendResponse(SOCKET clientSocket, const Response& response) {
-    string data = response.serialize() + "\n";
-    send(clientSocket, data.c_str(), data.length(), 0);
+// Repeated routes are answered from g_routeCache without g_dbMutex; the
+// graph version read with the lookup tells whether the entry is current.
+// The cached entry carries its formatted payload, so a hit touches neither
+// the graph nor the location index.
+// The search stops early once token fires; a search abandoned that way is
+// not cached. Only a request without a deadline leads a flight, so the
+// requests parked on it are never cut short by someone else's deadline;
+// if the leader's client leaves, the search is finished for them instead.
+Response findPath(const Request& req, RequestTimings& timings, const CancellationToken& token) {
+    int sourceId = req.getParamInt(ParamKey::SOURCE_ID);
+    int destId = req.getParamInt(ParamKey::DEST_ID);
+    
+    if (sourceId <= 0 || destId <= 0) {
+        return Response::error(req.clientId, req.requestId, "Invalid source or destination ID");
+    }
+    
+    RouteKey key(sourceId, destId);
+    uint64_t version = g_database->getGraphVersion();
+    shared_ptr<const CachedRoute> route;
+    if (g_routeCache.lookup(key, version, route)) {
+        return routeResponse(req, route, "hit");
+    }
+    
+    // Requests for this route that arrive while it is being searched park
+    // on the flight (see workerThread) and are answered from this result.
+    bool leading = !token.hasDeadline() && g_routeFlights.lead(key, version);
+    vector<RouteWaiter> waiters;
+    {
+        unique_lock<mutex> lock = lockDatabase(timings);
+        Navigation nav(g_database->getGraph(), g_database->getAdjacencyCache());
+        auto searched = make_shared<CachedRoute>();
+        searched->result = nav.dijkstra(sourceId, destId, token);
+        if (searched->result.aborted && leading) {
+            // Closing the flight first means nobody else joins a search
+            // that is being redone.
+            leading = false;
+            waiters = g_routeFlights.finish(key);
+            bool wanted = any_of(waiters.begin(), waiters.end(), [](const RouteWaiter& waiter) {
+                return !waiter.connection->disconnected;
+            });
+            if (wanted) {
+                searched->result = nav.dijkstra(sourceId, destId);
+            }
+        }
+        if (searched->result.found) {
+            searched->payload = formatRoute(searched->result);
+        }
+        timings.nodesSettled = searched->result.nodesSettled;
+        route = searched;
+        if (!route->result.aborted) {
+            g_routeCache.insert(key, g_database->getGraphVersion(), route);
+        }
+    }
+    if (leading) {
+        waiters = g_routeFlights.finish(key);
+    }
+    for (RouteWaiter& waiter : waiters) {
+        if (waiter.connection->disconnected) {
+            ServerStats::instance().recordCancelled(RequestType::FIND_PATH);
+            continue;
+        }
+        auto answeredAt = chrono::steady_clock::now();
+        waiter.timings.set(RequestPhase::EXECUTION, answeredAt - waiter.parkedAt);
+        Response response = routeResponse(waiter.request, route, "shared");
+        sendResponse(*waiter.connection, response);
+        waiter.timings.set(RequestPhase::SERIALIZATION, chrono::steady_clock::now() - answeredAt);
+        ServerStats::instance().recordRequest(RequestType::FIND_PATH, waiter.timings,
+            response.status == ResponseStatus::SUCCESS);
+    }
+    return routeResponse(req, route, "miss");
 }
 
-Response processRequest(const Request& req) {
-    lock_guard<mutex> lock(g_dbMutex);
+// Writes up to limit records with IDs above afterId, comma separated, and
+// returns how many were written. nextId is the last ID written when more
+// records follow and 0 when the table is exhausted.
+template<typename V, typename Format>
+int writePage(const BTree<int, V>& tree, int afterId, int limit, ostringstream& oss,
+              Format format, int& nextId) {
+    int written = 0;
+    int lastId = 0;
+    nextId = 0;
+    auto it = afterId < numeric_limits<int>::max() ? tree.lowerBound(afterId + 1) : typename BTree<int, V>::Cursor();
+    for (; it.valid(); it.next()) {
+        if (written == limit) {
+            nextId = lastId;
+            break;
+        }
+        if (written > 0) oss << ",";
+        format(oss, it.value());
+        lastId = it.key();
+        written++;
+    }
+    return written;
+}
+
+// One page of GET_LOCATIONS or GET_ROADS: up to limit records (default
+// DEFAULT_PAGE_LIMIT) with IDs above after_id. count is the table size;
+// next=ID, present when more records follow, is the after_id of the next
+// page. Caller holds g_dbMutex.
+Response tablePage(const Request& req, int afterId, int& nextId) {
+    int limit = req.getParamInt(ParamKey::LIMIT, DEFAULT_PAGE_LIMIT);
+    if (limit <= 0 || limit > MAX_PAGE_LIMIT) {
+        limit = MAX_PAGE_LIMIT;
+    }
+    
+    ostringstream oss;
+    int count;
+    int written;
+    string noun;
+    if (req.type == RequestType::GET_LOCATIONS) {
+        const auto& locations = g_database->getLocationTree();
+        count = locations.getCount();
+        noun = "locations";
+        oss << "count=" << count << ";locations=";
+        written = writePage(locations, afterId, limit, oss, [](ostringstream& out, const Location& loc) {
+            out << loc.id << ":" << loc.name;
+        }, nextId);
+    } else {
+        const auto& edges = g_database->getEdgeTree();
+        count = edges.getCount();
+        noun = "roads";
+        oss << "count=" << count << ";roads=";
+        written = writePage(edges, afterId, limit, oss, [](ostringstream& out, const Edge& edge) {
+            out << edge.edgeId << ":" << edge.sourceId
+                << "->" << edge.destinationId
+                << "(" << edge.distance << "km)";
+        }, nextId);
+    }
+    if (nextId != 0) {
+        oss << ";next=" << nextId;
+    }
     
-    log("Processing request: " + requestTypeToString(req.type) + 
+    string message = written == count
+        ? "Retrieved " + to_string(count) + " " + noun
+        : "Retrieved " + to_string(written) + " of " + to_string(count) + " " + noun;
+    return Response::success(req.clientId, req.requestId, message, oss.str());
+}
+
+// GET_LOCATIONS / GET_ROADS with stream=1: the pages follow one another as
+// separate responses under the same request ID, and the one without next=
+// ends the stream. g_dbMutex is taken per page, so a full dump neither
+// holds the lock nor builds the whole table in memory.
+void streamTable(const Request& req, ClientConnection& connection, RequestTimings& timings) {
+    auto startedAt = chrono::steady_clock::now();
+    int64_t lockWait = 0;
+    int64_t writeTime = 0;
+    int afterId = req.getParamInt(ParamKey::AFTER_ID);
+    bool succeeded = true;
+    
+    CancellationToken token = cancellationFor(req, connection);
+    while (true) {
+        if (token.isCancelled()) {
+            ServerStats::instance().recordCancelled(req.type);
+            return;
+        }
+        if (token.isExpired()) {
+            sendResponse(connection, deadlineResponse(req, "while streaming"));
+            ServerStats::instance().recordTimedOut(req.type);
+            succeeded = false;
+            break;
+        }
+        Response page;
+        int nextId;
+        {
+            RequestTimings pageTimings;
+            unique_lock<mutex> lock = lockDatabase(pageTimings);
+            lockWait += pageTimings.phaseMicros[static_cast<int>(RequestPhase::LOCK_WAIT)];
+            page = tablePage(req, afterId, nextId);
+        }
+        auto sendStart = chrono::steady_clock::now();
+        bool delivered = sendResponse(connection, page);
+        writeTime += chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - sendStart).count();
+        succeeded = succeeded && page.status == ResponseStatus::SUCCESS;
+        if (nextId == 0 || !delivered || !g_serverRunning) {
+            break;
+        }
+        afterId = nextId;
+    }
+    
+    timings.phaseMicros[static_cast<int>(RequestPhase::LOCK_WAIT)] = lockWait;
+    timings.phaseMicros[static_cast<int>(RequestPhase::SERIALIZATION)] = writeTime;
+    timings.set(RequestPhase::EXECUTION, chrono::steady_clock::now() - startedAt);
+    timings.phaseMicros[static_cast<int>(RequestPhase::EXECUTION)] -= lockWait + writeTime;
+    ServerStats::instance().recordRequest(req.type, timings, succeeded);
+}
+
+Response processRequest(const Request& req, RequestTimings& timings, const CancellationToken& token) {
+    LOG_REQUEST(req.clientId, req.requestId, "Processing request: " + requestTypeToString(req.type) +
         " from client " + to_string(req.clientId));
     
+    // Point lookups go through the concurrent location index and do not
+    // wait for g_dbMutex.
+    if (req.type == RequestType::GET_LOCATION) {
+        int id = req.getParamInt(ParamKey::ID);
+        Location loc;
+        if (g_database->lookupLocation(id, loc)) {
+            return Response::success(req.clientId, req.requestId,
+                "Location found", loc.toString());
+        } else {
+            return Response::error(req.clientId, req.requestId, "Location not found");
+        }
+    }
+    
+    if (req.type == RequestType::STATS) {
+        return Response::success(req.clientId, req.requestId, "Server statistics",
+            ServerStats::instance().formatSummary(currentGauges()));
+    }
+    
+    if (req.type == RequestType::FIND_PATH) {
+        return findPath(req, timings, token);
+    }
+    
+    unique_lock<mutex> lock = lockDatabase(timings);
+    
     switch (req.type) {
         case RequestType::ADD_LOCATION: {
-            string name = req.getParam("name");
-            double lat = req.getParamDouble("latitude");
-            double lon = req.getParamDouble("longitude");
-            string type = req.getParam("type");
+            string name = req.getParam(ParamKey::NAME);
+            double lat = req.getParamDouble(ParamKey::LATITUDE);
+            double lon = req.getParamDouble(ParamKey::LONGITUDE);
+            string type = req.getParam(ParamKey::TYPE);
             
             if (name.empty()) {
                 return Response::error(req.clientId, req.requestId, "Missing location name");
@@ -96,11 +537,11 @@ Response processRequest(const Request& req) {
         }
         
         case RequestType::ADD_ROAD: {
-            int sourceId = req.getParamInt("sourceId");
-            int destId = req.getParamInt("destId");
-            double distance = req.getParamDouble("distance");
-            string roadName = req.getParam("roadName");
-            bool bidir = req.getParamBool("bidirectional", true);
+            int sourceId = req.getParamInt(ParamKey::SOURCE_ID);
+            int destId = req.getParamInt(ParamKey::DEST_ID);
+            double distance = req.getParamDouble(ParamKey::DISTANCE);
+            string roadName = req.getParam(ParamKey::ROAD_NAME);
+            bool bidir = req.getParamBool(ParamKey::BIDIRECTIONAL, true);
             
             if (sourceId <= 0 || destId <= 0) {
                 return Response::error(req.clientId, req.requestId, "Invalid source or destination ID");
@@ -115,69 +556,33 @@ Response processRequest(const Request& req) {
             }
         }
         
-        case RequestType::FIND_PATH: {
-            int sourceId = req.getParamInt("sourceId");
-            int destId = req.getParamInt("destId");
-            
-            if (sourceId <= 0 || destId <= 0) {
-                return Response::error(req.clientId, req.requestId, "Invalid source or destination ID");
-            }
-            
-            Navigation nav(g_database->getGraph());
-            PathResult result = nav.dijkstra(sourceId, destId);
-            
-            if (result.found) {
-                ostringstream oss;
-                oss << "path=";
-                for (size_t i = 0; i < result.path.size(); i++) {
-                    if (i > 0) oss << "->";
-                    Location loc = g_database->getLocation(result.path[i]);
-                    oss << loc.name << "(" << result.path[i] << ")";
-                }
-                oss << ";distance=" << fixed << setprecision(2) << result.totalDistance;
-                
-                return Response::success(req.clientId, req.requestId,
-                    "Path found", oss.str());
-            } else {
-                return Response::error(req.clientId, req.requestId, result.errorMessage);
-            }
+        case RequestType::GET_LOCATIONS:
+        case RequestType::GET_ROADS: {
+            int nextId;
+            return tablePage(req, req.getParamInt(ParamKey::AFTER_ID), nextId);
         }
         
-        case RequestType::GET_LOCATIONS: {
-            auto locations = g_database->getAllLocations();
-            ostringstream oss;
-            oss << "count=" << locations.size() << ";locations=";
-            for (size_t i = 0; i < locations.size(); i++) {
-                if (i > 0) oss << ",";
-                oss << locations[i].id << ":" << locations[i].name;
+        case RequestType::SEARCH_LOCATION: {
+            string prefix = req.getParam(ParamKey::PREFIX);
+            int limit = req.getParamInt(ParamKey::LIMIT, DEFAULT_SEARCH_LIMIT);
+            
+            if (limit <= 0 || limit > MAX_SEARCH_LIMIT) {
+                limit = MAX_SEARCH_LIMIT;
             }
-            return Response::success(req.clientId, req.requestId,
-                "Retrieved " + to_string(locations.size()) + " locations", oss.str());
-        }
-        
-        case RequestType::GET_ROADS: {
-            auto edges = g_database->getAllEdges();
+            
+            // fuzzy=1 treats the text as a possibly misspelt full name and
+            // ranks matches by edit distance instead of by name.
+            vector<Location> matches = req.getParamBool(ParamKey::FUZZY)
+                ? g_database->fuzzySearchLocations(prefix, limit)
+                : g_database->searchLocations(prefix, limit);
             ostringstream oss;
-            oss << "count=" << edges.size() << ";roads=";
-            for (size_t i = 0; i < edges.size(); i++) {
+            oss << "count=" << matches.size() << ";locations=";
+            for (size_t i = 0; i < matches.size(); i++) {
                 if (i > 0) oss << ",";
-                oss << edges[i].edgeId << ":" << edges[i].sourceId 
-                    << "->" << edges[i].destinationId 
-                    << "(" << edges[i].distance << "km)";
+                oss << matches[i].id << ":" << matches[i].name;
             }
             return Response::success(req.clientId, req.requestId,
-                "Retrieved " + to_string(edges.size()) + " roads", oss.str());
-        }
-        
-        case RequestType::GET_LOCATION: {
-            int id = req.getParamInt("id");
-            Location loc = g_database->getLocation(id);
-            if (loc.id > 0) {
-                return Response::success(req.clientId, req.requestId,
-                    "Location found", loc.toString());
-            } else {
-                return Response::error(req.clientId, req.requestId, "Location not found");
-            }
+                "Found " + to_string(matches.size()) + " locations", oss.str());
         }
         
         case RequestType::INIT_SAMPLE: {
@@ -204,24 +609,103 @@ Response processRequest(const Request& req) {
     }
 }
 
+// Applies a staged import under the database lock and reports the result.
+Response applyImport(const Request& req, ImportBatch& batch, RequestTimings& timings) {
+    string error;
+    bool applied;
+    {
+        unique_lock<mutex> lock = lockDatabase(timings);
+        applied = g_database->importBatch(batch, error);
+    }
+    
+    if (!applied) {
+        return Response::error(req.clientId, req.requestId, "Import rejected: " + error);
+    }
+    log("Imported " + to_string(batch.locations.size()) + " locations and " +
+        to_string(batch.edges.size()) + " roads from client " + to_string(req.clientId));
+    return Response::success(req.clientId, req.requestId, "Import applied",
+        "locations=" + to_string(batch.locations.size()) + ";roads=" + to_string(batch.edges.size()));
+}
+
 void workerThread(int workerId) {
     log("Worker " + to_string(workerId) + " started");
     
     while (g_serverRunning) {
-        pair<Request, SOCKET> item;
+        QueuedRequest item;
+        int requestClass;
         
-        if (g_requestQueue.dequeue(item)) {
-            Request& req = item.first;
-            SOCKET clientSocket = item.second;
+        if (g_requestQueue.dequeue(item, requestClass)) {
+            Request& req = item.request;
+            ClientConnection& connection = *item.connection;
             
-            log("Worker " + to_string(workerId) + " processing request " + 
+            LOG_REQUEST(req.clientId, req.requestId, "Worker " + to_string(workerId) + " processing request " +
                 to_string(req.requestId) + " from client " + to_string(req.clientId));
             
-            Response response = processRequest(req);
+            RequestTimings timings;
+            auto dequeuedAt = chrono::steady_clock::now();
+            timings.set(RequestPhase::QUEUE_WAIT, dequeuedAt - req.receivedAt);
+            
+            // Work nobody is waiting for any more is dropped here, before
+            // it can take the database lock.
+            CancellationToken token = cancellationFor(req, connection);
+            if (token.isCancelled()) {
+                ServerStats::instance().recordCancelled(req.type);
+                g_requestQueue.finish(requestClass, -1);
+                continue;
+            }
+            if (token.isExpired()) {
+                sendResponse(connection, deadlineResponse(req, "in queue"));
+                ServerStats::instance().recordTimedOut(req.type);
+                ServerStats::instance().recordRequest(req.type, timings, false);
+                g_requestQueue.finish(requestClass, -1);
+                continue;
+            }
+            
+            if ((req.type == RequestType::GET_LOCATIONS || req.type == RequestType::GET_ROADS) &&
+                req.getParamBool(ParamKey::STREAM)) {
+                streamTable(req, connection, timings);
+                g_requestQueue.finish(requestClass, chrono::duration_cast<chrono::microseconds>(
+                    chrono::steady_clock::now() - dequeuedAt).count());
+                continue;
+            }
+            
+            // An identical route search already running will answer this
+            // one too, so the worker moves on to the next request. One with
+            // a deadline runs its own search, which the deadline can stop.
+            if (req.type == RequestType::FIND_PATH && !token.hasDeadline()) {
+                RouteKey key(req.getParamInt(ParamKey::SOURCE_ID), req.getParamInt(ParamKey::DEST_ID));
+                RouteWaiter waiter{req, item.connection, timings, dequeuedAt};
+                if (g_routeFlights.join(key, g_database->getGraphVersion(), waiter)) {
+                    g_requestQueue.finish(requestClass, -1);
+                    continue;
+                }
+            }
+            
+            Response response = req.type == RequestType::IMPORT
+                ? applyImport(req, *item.importBatch, timings)
+                : processRequest(req, timings, token);
+            auto processedAt = chrono::steady_clock::now();
+            
+            bool delivered = sendResponse(connection, response);
+            if (!delivered && token.isCancelled()) {
+                ServerStats::instance().recordCancelled(req.type);
+            } else if (response.status == ResponseStatus::TIMEOUT) {
+                ServerStats::instance().recordTimedOut(req.type);
+            }
+            g_requestQueue.finish(requestClass, chrono::duration_cast<chrono::microseconds>(
+                chrono::steady_clock::now() - dequeuedAt).count());
             
-            sendResponse(clientSocket, response);
+            // Execution excludes the time spent waiting for g_dbMutex.
+            timings.set(RequestPhase::EXECUTION, processedAt - dequeuedAt);
+            if (timings.phaseMicros[static_cast<int>(RequestPhase::LOCK_WAIT)] > 0) {
+                timings.phaseMicros[static_cast<int>(RequestPhase::EXECUTION)] -=
+                    timings.phaseMicros[static_cast<int>(RequestPhase::LOCK_WAIT)];
+            }
+            timings.set(RequestPhase::SERIALIZATION, chrono::steady_clock::now() - processedAt);
+            ServerStats::instance().recordRequest(req.type, timings,
+                response.status == ResponseStatus::SUCCESS);
             
-            log("Worker " + to_string(workerId) + " completed request " + 
+            LOG_REQUEST(req.clientId, req.requestId, "Worker " + to_string(workerId) + " completed request " +
                 to_string(req.requestId));
         }
     }
@@ -229,17 +713,40 @@ void workerThread(int workerId) {
     log("Worker " + to_string(workerId) + " stopped");
 }
 
+// Queues a request in its class, or answers it at once if the class is
+// over its admission limits.
+void enqueueRequest(const Request& req, const shared_ptr<ClientConnection>& connection,
+                    shared_ptr<ImportBatch> importBatch = nullptr) {
+    RequestClass requestClass = requestClassOf(req.type);
+    if (!g_requestQueue.tryEnqueue({req, connection, move(importBatch)}, static_cast<int>(requestClass))) {
+        Response busy(req.clientId, req.requestId, ResponseStatus::FAILURE,
+            "Server busy, " + requestClassToString(requestClass) + " queue full");
+        sendResponse(*connection, busy);
+        ServerStats::instance().recordRejected(req.type);
+    }
+}
+
 void handleClient(SOCKET clientSocket, int clientId) {
+    auto connection = make_shared<ClientConnection>(clientSocket, clientId);
     log("Client " + to_string(clientId) + " connected");
+    ServerStats::instance().connectionOpened();
     
     Response welcome(clientId, 0, ResponseStatus::SUCCESS, 
         "Welcome to Mini Google Maps Server. Client ID: " + to_string(clientId));
-    sendResponse(clientSocket, welcome);
+    sendResponse(*connection, welcome);
     
     char buffer[BUFFER_SIZE];
     string partialData;
     int requestCounter = 1;
     
+    // An IMPORT header is followed by its record lines on the same
+    // connection. They are staged here as they arrive rather than queued
+    // one by one, and the batch is queued once the last line is in.
+    Request importRequest;
+    shared_ptr<ImportBatch> importBatch;
+    int importRemaining = 0;
+    bool dropClient = false;
+    
     while (g_serverRunning) {
         memset(buffer, 0, BUFFER_SIZE);
         int bytesReceived = recv(clientSocket, buffer, BUFFER_SIZE - 1, 0);
@@ -250,30 +757,63 @@ void handleClient(SOCKET clientSocket, int clientId) {
         
         partialData += string(buffer, bytesReceived);
         
+        size_t start = 0;
         size_t pos;
-        while ((pos = partialData.find('\n')) != string::npos) {
-            string message = partialData.substr(0, pos);
-            partialData = partialData.substr(pos + 1);
+        while ((pos = partialData.find('\n', start)) != string::npos) {
+            string message = partialData.substr(start, pos - start);
+            start = pos + 1;
+            
+            if (importBatch != nullptr) {
+                importBatch->addLine(message);
+                if (--importRemaining == 0) {
+                    importRequest.receivedAt = chrono::steady_clock::now();
+                    enqueueRequest(importRequest, connection, move(importBatch));
+                }
+                continue;
+            }
             
             if (message.empty()) continue;
             
             Request req = Request::deserialize(message);
             req.clientId = clientId;
             req.requestId = requestCounter++;
+            req.receivedAt = chrono::steady_clock::now();
+            int deadlineMs = req.getParamInt(ParamKey::DEADLINE_MS);
+            if (deadlineMs > 0) {
+                req.deadline = req.receivedAt + chrono::milliseconds(deadlineMs);
+            }
             
-            log("Received request: " + requestTypeToString(req.type) + 
+            LOG_REQUEST(clientId, req.requestId, "Received request: " + requestTypeToString(req.type) +
                 " from client " + to_string(clientId));
             
-            if (!g_requestQueue.tryEnqueue({req, clientSocket})) {
-                Response busy(clientId, req.requestId, ResponseStatus::FAILURE, 
-                    "Server busy, request queue full");
-                sendResponse(clientSocket, busy);
+            if (req.type == RequestType::IMPORT) {
+                int records = req.getParamInt(ParamKey::RECORDS);
+                if (records < 0 || records > MAX_IMPORT_RECORDS) {
+                    sendResponse(*connection, Response::error(clientId, req.requestId,
+                        "Import must have 0 to " + to_string(MAX_IMPORT_RECORDS) + " records"));
+                    dropClient = true;
+                    break;
+                }
+                importRequest = req;
+                importBatch = make_shared<ImportBatch>();
+                importRemaining = records;
+                if (importRemaining == 0) {
+                    enqueueRequest(importRequest, connection, move(importBatch));
+                }
+                continue;
             }
+            
+            enqueueRequest(req, connection);
+        }
+        partialData.erase(0, start);
+        if (dropClient) {
+            break;
         }
     }
     
+    connection->disconnected = true;
+    ServerStats::instance().connectionClosed();
     log("Client " + to_string(clientId) + " disconnected");
-    closesocket(clientSocket);
 }
 
 bool initializeSockets() {
@@ -294,7 +834,64 @@ void cleanupSockets() {
 #endif
 }
 
-int main() {
+// Rewrites the Prometheus text file every METRICS_DUMP_INTERVAL_MS, for a
+// node_exporter textfile collector or anything else that scrapes files.
+void metricsThread(string path) {
+    log("Writing metrics to " + path);
+    while (g_serverRunning) {
+        for (int waited = 0; waited < METRICS_DUMP_INTERVAL_MS && g_serverRunning; waited += 100) {
+            this_thread::sleep_for(chrono::milliseconds(100));
+        }
+        if (!ServerStats::instance().writePrometheusFile(path, currentGauges())) {
+            log("Failed to write metrics to " + path, LogLevel::WARN);
+        }
+    }
+}
+
+// Offline import modes; each applies one file set, saves and exits:
+//   server --import FILE              ImportBatch record lines
+//   server --import-dimacs GR CO      DIMACS 9th challenge arcs + coordinates
+//   server --import-csv NODES EDGES   CSV nodes + edges
+bool runOfflineImport(int argc, char* argv[]) {
+    string mode = argv[1];
+    ImportBatch batch;
+    string error;
+    bool parsed = false;
+    
+    auto start = chrono::steady_clock::now();
+    if (mode == "--import" && argc >= 3) {
+        ifstream file(argv[2]);
+        if (!file.is_open()) {
+            error = "cannot open " + string(argv[2]);
+        } else if (!batch.readFrom(file)) {
+            error = batch.error;
+        } else {
+            parsed = true;
+        }
+    } else if (mode == "--import-dimacs" && argc >= 4) {
+        parsed = RoadNetworkImporter::loadDimacs(argv[2], argv[3], batch, error);
+    } else if (mode == "--import-csv" && argc >= 4) {
+        parsed = RoadNetworkImporter::loadCsv(argv[2], argv[3], batch, error);
+    } else {
+        error = "usage: server --import FILE | --import-dimacs GR CO | --import-csv NODES EDGES";
+    }
+    auto parsedAt = chrono::steady_clock::now();
+    
+    if (!parsed || !g_database->importBatch(batch, error)) {
+        cerr << "Import failed: " << error << endl;
+        return false;
+    }
+    auto appliedAt = chrono::steady_clock::now();
+    
+    g_database->saveData();
+    log("Imported " + to_string(batch.locations.size()) + " locations and " +
+        to_string(batch.edges.size()) + " roads (parse " +
+        to_string(chrono::duration_cast<chrono::milliseconds>(parsedAt - start).count()) + " ms, apply " +
+        to_string(chrono::duration_cast<chrono::milliseconds>(appliedAt - parsedAt).count()) + " ms)");
+    return true;
+}
+
+int main(int argc, char* argv[]) {
     cout << "\n";
     cout << "========================================" << endl;
     cout << "  MINI GOOGLE MAPS NAVIGATION SERVER" << endl;
@@ -304,9 +901,12 @@ int main() {
     if (!initializeSockets()) {
         return 1;
     }
+    ServerStats::instance();  // starts the uptime clock
     
     log("Initializing database...");
+    Logger::instance().flush();
     g_database = new DatabaseManager("data");
+    g_database->setLazyGraph(true);
     if (!g_database->initialize()) {
         cerr << "Failed to initialize database" << endl;
         delete g_database;
@@ -316,6 +916,13 @@ int main() {
     log("Database initialized: " + to_string(g_database->getLocationCount()) + 
         " locations, " + to_string(g_database->getEdgeCount()) + " roads");
     
+    if (argc >= 2 && string(argv[1]).find("--import") == 0) {
+        bool ok = runOfflineImport(argc, argv);
+        delete g_database;
+        cleanupSockets();
+        return ok ? 0 : 1;
+    }
+    
     SOCKET serverSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
     if (serverSocket == INVALID_SOCKET) {
         cerr << "Failed to create socket" << endl;
@@ -349,7 +956,11 @@ int main() {
     }
     
     log("Server listening on port " + to_string(SERVER_PORT));
-    log("Request queue capacity: " + to_string(QUEUE_CAPACITY));
+    for (int c = 0; c < REQUEST_CLASS_COUNT; c++) {
+        log("Request queue " + requestClassToString(static_cast<RequestClass>(c)) + ": up to " +
+            to_string(SCHEDULER_CLASSES[c].maxDepth) + " queued, " +
+            to_string(SCHEDULER_CLASSES[c].maxRunning) + " running");
+    }
     
     vector<thread> workers;
     for (int i = 0; i < NUM_WORKER_THREADS; i++) {
@@ -357,6 +968,13 @@ int main() {
     }
     log("Started " + to_string(NUM_WORKER_THREADS) + " worker threads");
     
+    // server --metrics-file PATH keeps a Prometheus text dump up to date.
+    thread metrics;
+    if (argc >= 3 && string(argv[1]) == "--metrics-file") {
+        metrics = thread(metricsThread, string(argv[2]));
+    }
+    
+    Logger::instance().flush();
     cout << "\nServer ready! Waiting for connections..." << endl;
     cout << "Press Ctrl+C to shutdown\n" << endl;
     
@@ -368,7 +986,7 @@ int main() {
         
         if (clientSocket == INVALID_SOCKET) {
             if (g_serverRunning) {
-                log("Accept failed");
+                log("Accept failed", LogLevel::WARN);
             }
             continue;
         }
@@ -387,6 +1005,9 @@ int main() {
             worker.join();
         }
     }
+    if (metrics.joinable()) {
+        metrics.join();
+    }
     
     g_database->saveData();
     
@@ -395,5 +1016,6 @@ int main() {
     cleanupSockets();
     
     log("Server stopped");
+    Logger::instance().stop();
     return 0;
 }